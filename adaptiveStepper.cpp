@@ -0,0 +1,140 @@
+#include <cmath>
+#include "adaptiveStepper.hpp"
+#include "tracer.hpp"
+#include "trackerStats.hpp"
+
+using namespace std;
+
+// trial state columns per pool - origin carbon, then untracked carbon
+static const int WIDTH = CarbonTracker::LAST + 1;
+
+AdaptiveStepper::AdaptiveStepper(double safeFraction, double tolerance, int maxSubsteps)
+    : safeFraction(safeFraction), tolerance(tolerance), maxSubsteps(maxSubsteps), nSteps(0), nRefined(0), nSubsteps(0), nUnconverged(0){
+    H_ASSERT(safeFraction > 0 && safeFraction < 1, "Safe fraction must be between 0 and 1");
+    H_ASSERT(tolerance > 0, "Tolerance must be positive");
+    H_ASSERT(maxSubsteps >= 1, "Steps need at least one sub-step");
+}
+
+void AdaptiveStepper::addFlux(int src, int dst, double rate){
+    H_ASSERT(src >= 0 && dst >= 0 && src != dst, "A flux needs two different pools");
+    H_ASSERT(rate >= 0, "Flux rates can't be negative - add the flux the other way");
+    Flux f = {src, dst, rate};
+    fluxes.push_back(f);
+}
+
+void AdaptiveStepper::setRate(size_t flux, double rate){
+    H_ASSERT(flux < fluxes.size(), "No such flux");
+    H_ASSERT(rate >= 0, "Flux rates can't be negative - add the flux the other way");
+    fluxes[flux].rate = rate;
+}
+
+void AdaptiveStepper::simulate(vector<double>& state, size_t nPools, double dt, int n){
+    double h = dt / n;
+    totals.resize(nPools);
+    for(int sub = 0; sub < n; ++sub){
+        // explicit - every flux is sized from the pools at the start of the sub-step, then moved in order
+        for(size_t p = 0; p < nPools; ++p){
+            totals[p] = 0;
+            for(int o = 0; o < WIDTH; ++o){
+                totals[p] += state[p * WIDTH + o];
+            }
+        }
+        for(size_t f = 0; f < fluxes.size(); ++f){
+            amounts[f] = fluxes[f].rate * h * totals[fluxes[f].src];
+        }
+        for(size_t f = 0; f < fluxes.size(); ++f){
+            double* src = &state[fluxes[f].src * WIDTH];
+            double* dst = &state[fluxes[f].dst * WIDTH];
+            double srcC = 0;
+            for(int o = 0; o < WIDTH; ++o){
+                srcC += src[o];
+            }
+            if(srcC == 0){
+                continue;
+            }
+            for(int o = 0; o < WIDTH; ++o){
+                double moved = amounts[f] * (src[o] / srcC);
+                src[o] -= moved;
+                dst[o] += moved;
+            }
+        }
+    }
+}
+
+void AdaptiveStepper::run(CarbonTracker* pools, double dt, int n){
+    double h = dt / n;
+    for(int sub = 0; sub < n; ++sub){
+        for(size_t f = 0; f < fluxes.size(); ++f){
+            amounts[f] = fluxes[f].rate * h * pools[fluxes[f].src].getTotalCarbon().value(Hector::U_PGC);
+        }
+        for(size_t f = 0; f < fluxes.size(); ++f){
+            CarbonTracker::transfer(pools[fluxes[f].src], pools[fluxes[f].dst], Hector::unitval(amounts[f], Hector::U_PGC));
+        }
+    }
+}
+
+int AdaptiveStepper::step(CarbonTracker* pools, size_t nPools, double dt){
+    CT_TRACE_SPAN("AdaptiveStepper::step", "tracker");
+    amounts.resize(fluxes.size());
+    outflow.assign(nPools, 0);
+    for(size_t f = 0; f < fluxes.size(); ++f){
+        H_ASSERT((size_t)fluxes[f].src < nPools && (size_t)fluxes[f].dst < nPools, "Flux pool index out of range");
+        outflow[fluxes[f].src] += fluxes[f].rate * dt;
+    }
+    double maxOut = 0;
+    for(size_t p = 0; p < nPools; ++p){
+        maxOut = fmax(maxOut, outflow[p]);
+    }
+    ++nSteps;
+    if(maxOut <= safeFraction){
+        run(pools, dt, 1);
+        ++nSubsteps;
+        return 1;
+    }
+
+    // stiff step - start from the fewest sub-steps that keep every pool within the safe fraction, then double
+    // until a pool by pool comparison with twice as many agrees
+    double needed = ceil(maxOut / safeFraction);
+    H_ASSERT(needed <= maxSubsteps, "Fluxes need more than maxSubsteps sub-steps to stay within the safe fraction");
+    int n = (int)needed;
+    start.resize(nPools * WIDTH);
+    for(size_t p = 0; p < nPools; ++p){
+        double total = pools[p].getTotalCarbon().value(Hector::U_PGC);
+        double* fracs = pools[p].getOriginFracs();
+        for(int o = 0; o < CarbonTracker::LAST; ++o){
+            start[p * WIDTH + o] = fracs[o] * total;
+        }
+        start[p * WIDTH + CarbonTracker::LAST] = pools[p].getUntrackedFrac() * total;
+    }
+    coarse = start;
+    simulate(coarse, nPools, dt, n);
+    bool converged = false;
+    while(2 * n <= maxSubsteps){
+        fine = start;
+        simulate(fine, nPools, dt, 2 * n);
+        n *= 2;
+        converged = true;
+        for(size_t p = 0; p < nPools && converged; ++p){
+            double total = 0;
+            double error = 0;
+            for(int o = 0; o < WIDTH; ++o){
+                total += fine[p * WIDTH + o];
+                error = fmax(error, fabs(fine[p * WIDTH + o] - coarse[p * WIDTH + o]));
+            }
+            converged = error <= tolerance * total;
+        }
+        if(converged){
+            break;
+        }
+        coarse.swap(fine);
+    }
+    // out of sub-steps - the finest run is still the best estimate, so a deferred check goes on with it
+    if(!converged){
+        ++nUnconverged;
+    }
+    CT_VALID(converged, NOT_CONVERGED, "Step didn't converge within maxSubsteps sub-steps");
+    run(pools, dt, n);
+    ++nRefined;
+    nSubsteps += n;
+    return n;
+}
@@ -0,0 +1,130 @@
+#ifndef ADAPTIVESTEPPER_HPP
+#define ADAPTIVESTEPPER_HPP
+#include <vector>
+#include <stdint.h>
+#include "carbonTracker.hpp"
+
+using namespace std;
+
+  /**
+   * \brief AdaptiveStepper Class: steps a set of first order (donor controlled) fluxes between pools, sub-dividing
+   *        only the steps where a pool would lose more than a safe fraction of its carbon
+   *
+   * A step whose largest outflow fraction (sum of a pool's outgoing rates * dt) is within safeFraction runs as a
+   * single explicit step, exactly as a hand written sequence of transfers would. Otherwise it is split into n
+   * sub-steps, n doubling until every pool's origin carbon agrees with the 2n result to within tolerance of the
+   * pool's carbon. The trial runs are done on plain doubles, so only the chosen sub-steps reach the trackers
+   * (and any journal or tape) - as CarbonTracker::transfer calls, so mass and origin fractions stay consistent.
+   * A step that runs out of sub-steps before it agrees fails a NOT_CONVERGED check (CT_VALID): it throws and
+   * leaves the pools as they were, or with deferred validation is flagged and applied at maxSubsteps
+   */
+  class AdaptiveStepper{
+   public:
+
+    // Flux moving rate * (carbon of pools[src]) per unit time to pools[dst]
+    struct Flux {
+      int src;
+      int dst;
+      double rate;
+    };
+
+   private:
+    vector<Flux> fluxes;
+    double safeFraction;
+    double tolerance;
+    int maxSubsteps;
+
+    uint64_t nSteps;
+    uint64_t nRefined;
+    uint64_t nSubsteps;
+    uint64_t nUnconverged;
+
+    // origin carbon (and untracked carbon last) of every pool for the trial runs, pool by pool
+    vector<double> start;
+    vector<double> coarse;
+    vector<double> fine;
+
+    // scratch kept between steps - each flux's amount in a sub-step, each pool's carbon and outflow fraction
+    vector<double> amounts;
+    vector<double> totals;
+    vector<double> outflow;
+
+    /**
+      * \brief runs the fluxes over dt in n explicit sub-steps on the trial state
+      */
+    void simulate(vector<double>& state, size_t nPools, double dt, int n);
+
+    /**
+      * \brief runs the fluxes over dt in n explicit sub-steps on the trackers
+      */
+    void run(CarbonTracker* pools, double dt, int n);
+
+   public:
+
+    /**
+      * \brief constructor
+      * \param safeFraction largest fraction of a pool's carbon a single (sub-)step may take out of it, in (0, 1)
+      * \param tolerance largest difference, relative to a pool's carbon, between a refined step and one refined
+      *        twice as finely, in any origin of any pool
+      * \param maxSubsteps most sub-steps a step may be split into
+      */
+    AdaptiveStepper(double safeFraction = 0.5, double tolerance = 1e-6, int maxSubsteps = 4096);
+
+    /**
+      * \brief adds a flux - applied in the order added
+      * \param src index of the pool the carbon leaves
+      * \param dst index of the pool the carbon enters
+      * \param rate fraction of src's carbon moved per unit time
+      */
+    void addFlux(int src, int dst, double rate);
+
+    /**
+      * \brief changes the rate of a flux, e.g. as the climate changes
+      * \param flux index of the flux in the order added
+      * \param rate fraction of src's carbon moved per unit time
+      */
+    void setRate(size_t flux, double rate);
+
+    const vector<Flux>& getFluxes() const{
+        return fluxes;
+    }
+
+    /**
+      * \brief advances the pools by dt
+      * \param pools pools the flux indices refer to
+      * \param nPools number of pools - every flux index must be below it
+      * \param dt time step
+      * \return number of sub-steps the step took (1 if it wasn't refined)
+      */
+    int step(CarbonTracker* pools, size_t nPools, double dt);
+
+    /**
+      * \brief getter for the number of steps taken
+      */
+    uint64_t steps() const{
+        return nSteps;
+    }
+
+    /**
+      * \brief getter for the number of steps that were refined
+      */
+    uint64_t refinedSteps() const{
+        return nRefined;
+    }
+
+    /**
+      * \brief getter for the number of sub-steps run over all steps
+      */
+    uint64_t substeps() const{
+        return nSubsteps;
+    }
+
+    /**
+      * \brief getter for the number of steps that hit maxSubsteps before they were within tolerance
+      */
+    uint64_t unconvergedSteps() const{
+        return nUnconverged;
+    }
+  };
+
+#endif
@@ -0,0 +1,250 @@
+#include <cstdio>
+#include <fstream>
+#include <unordered_map>
+#include <vector>
+#include "adjointTape.hpp"
+#include "tracer.hpp"
+
+using namespace std;
+
+const uint32_t AdjointTape::NO_NODE;
+
+// adjoint of one node - one value per origin
+struct OriginAdjoint {
+    double v[CarbonTracker::LAST];
+};
+
+// index of the leaf for node in leaves (which are in node order) - leaves.size() if there is none
+static size_t findLeaf(const vector<AdjointTape::Leaf>& leaves, uint32_t node){
+    size_t lo = 0, hi = leaves.size();
+    while(lo < hi){
+        size_t mid = (lo + hi) / 2;
+        if(leaves[mid].node < node){
+            lo = mid + 1;
+        }
+        else{
+            hi = mid;
+        }
+    }
+    return lo < leaves.size() && leaves[lo].node == node ? lo : leaves.size();
+}
+
+AdjointTape::AdjointTape(const string& checkpointPath, size_t segmentEntries)
+    : checkpointPath(checkpointPath), segmentEntries(segmentEntries), spilledEntries(0), spilledLeaves(0),
+      checkpointEnd(0), nextNode(0), timestep(0){
+    H_ASSERT(segmentEntries > 0, "Tape segments need at least one entry");
+    H_ASSERT(!checkpointPath.empty(), "Adjoint tape needs a checkpoint file");
+    entries.reserve(segmentEntries);
+    leaves.reserve(segmentEntries);
+}
+
+AdjointTape::~AdjointTape(){
+    if(checkpoint.is_open()){
+        checkpoint.close();
+        remove(checkpointPath.c_str());
+    }
+}
+
+void AdjointTape::setTimestep(uint32_t t){
+    this->timestep = t;
+}
+
+void AdjointTape::watch(CarbonTracker& ct){
+    ct.tapeNode = recordLeaf(INPUT, ct.homePool, ct.totalCarbon.value(Hector::U_PGC), ct.originFracs);
+}
+
+uint32_t AdjointTape::recordLeaf(LeafKind kind, CarbonTracker::Pool pool, double amount, const double* fracs){
+    H_ASSERT(nextNode != NO_NODE, "Adjoint tape is out of nodes");
+    H_ASSERT(kind != FLUX || CarbonTracker::track, "Flux recorded on the adjoint tape without tracking - its sensitivity would be 0");
+    if(leaves.size() == segmentEntries){
+        spill();
+    }
+    Leaf leaf;
+    leaf.node = nextNode++;
+    leaf.timestep = this->timestep;
+    leaf.amount = amount;
+    for(int i = 0; i < CarbonTracker::LAST; ++i){
+        leaf.fracs[i] = fracs[i];
+    }
+    leaf.sensitivity = 0;
+    leaf.kind = (uint8_t)kind;
+    leaf.pool = (uint8_t)pool;
+    leaves.push_back(leaf);
+    return leaf.node;
+}
+
+uint32_t AdjointTape::record(uint32_t a, double wa, uint32_t b, double wb){
+    if(a == NO_NODE && b == NO_NODE){
+        return NO_NODE;
+    }
+    H_ASSERT(nextNode != NO_NODE, "Adjoint tape is out of nodes");
+    if(entries.size() == segmentEntries){
+        spill();
+    }
+    Entry e;
+    e.wa = wa;
+    e.wb = wb;
+    e.out = nextNode++;
+    e.a = a;
+    e.b = b;
+    entries.push_back(e);
+    return e.out;
+}
+
+void AdjointTape::spill(){
+    // a segment is everything recorded since the last spill - its entries, then its leaves
+    CT_TRACE_SPAN("AdjointTape::spill", "io");
+    if(!checkpoint.is_open()){
+        checkpoint.open(checkpointPath.c_str(), ios::binary | ios::in | ios::out | ios::trunc);
+        H_ASSERT(checkpoint.is_open(), "Could not open adjoint checkpoint file " + checkpointPath);
+    }
+    Segment seg;
+    seg.offset = checkpointEnd;
+    seg.nEntries = (uint32_t)entries.size();
+    seg.nLeaves = (uint32_t)leaves.size();
+    seg.endNode = nextNode;
+    checkpoint.seekp(seg.offset);
+    if(seg.nEntries){
+        checkpoint.write((const char*)&entries[0], seg.nEntries * sizeof(Entry));
+    }
+    if(seg.nLeaves){
+        checkpoint.write((const char*)&leaves[0], seg.nLeaves * sizeof(Leaf));
+    }
+    H_ASSERT(!checkpoint.fail(), "Could not write adjoint checkpoint file " + checkpointPath);
+    checkpointEnd += seg.nEntries * sizeof(Entry) + seg.nLeaves * sizeof(Leaf);
+    spilledEntries += seg.nEntries;
+    spilledLeaves += seg.nLeaves;
+    spilled.push_back(seg);
+    CT_TRACE_COUNTER("tape segments spilled", spilled.size());
+    entries.clear();
+    leaves.clear();
+}
+
+void AdjointTape::readLeaves(const Segment& seg, vector<Leaf>& out){
+    out.resize(seg.nLeaves);
+    if(seg.nLeaves){
+        checkpoint.flush();
+        checkpoint.seekg(seg.offset + seg.nEntries * sizeof(Entry));
+        checkpoint.read((char*)&out[0], seg.nLeaves * sizeof(Leaf));
+    }
+}
+
+void AdjointTape::reverse(CarbonTracker& target, const double* originWeights){
+    CT_TRACE_SPAN("AdjointTape::reverse", "adjoint");
+    H_ASSERT(target.tapeNode != NO_NODE, "Target is not on the adjoint tape");
+
+    // only nodes still waiting for their producing entry are held, so this is bounded by the live values
+    unordered_map<uint32_t, OriginAdjoint> adjoints;
+    OriginAdjoint& seed = adjoints[target.tapeNode];
+    for(int i = 0; i < CarbonTracker::LAST; ++i){
+        seed.v[i] = originWeights ? originWeights[i] : 1;
+    }
+
+    vector<Entry> segment;
+    vector<Leaf> segmentLeaves;
+    for(size_t s = spilled.size() + 1; s-- > 0; ){
+        const vector<Entry>* current = &entries;
+        vector<Leaf>* currentLeaves = &leaves;
+        if(s < spilled.size()){
+            const Segment& seg = spilled[s];
+            segment.resize(seg.nEntries);
+            if(seg.nEntries){
+                checkpoint.flush();
+                checkpoint.seekg(seg.offset);
+                checkpoint.read((char*)&segment[0], seg.nEntries * sizeof(Entry));
+            }
+            readLeaves(seg, segmentLeaves);
+            current = &segment;
+            currentLeaves = &segmentLeaves;
+        }
+        for(size_t k = current->size(); k-- > 0; ){
+            const Entry& e = (*current)[k];
+            unordered_map<uint32_t, OriginAdjoint>::iterator found = adjoints.find(e.out);
+            if(found == adjoints.end()){
+                continue;   // the target doesn't depend on this value
+            }
+            OriginAdjoint adjOut = found->second;
+            adjoints.erase(found);
+            if(e.a != NO_NODE){
+                OriginAdjoint& adjA = adjoints[e.a];
+                for(int i = 0; i < CarbonTracker::LAST; ++i){
+                    adjA.v[i] += e.wa * adjOut.v[i];
+                }
+            }
+            if(e.b != NO_NODE){
+                OriginAdjoint& adjB = adjoints[e.b];
+                for(int i = 0; i < CarbonTracker::LAST; ++i){
+                    adjB.v[i] += e.wb * adjOut.v[i];
+                }
+            }
+        }
+
+        // nothing earlier on the tape can refer to this segment's leaves, so their adjoints are final - a leaf's
+        // carbon is amount * fracs, so its sensitivity is the fraction weighted adjoint
+        for(size_t l = 0; l < currentLeaves->size(); ++l){
+            Leaf& leaf = (*currentLeaves)[l];
+            leaf.sensitivity = 0;
+            unordered_map<uint32_t, OriginAdjoint>::iterator found = adjoints.find(leaf.node);
+            if(found != adjoints.end()){
+                for(int i = 0; i < CarbonTracker::LAST; ++i){
+                    leaf.sensitivity += found->second.v[i] * leaf.fracs[i];
+                }
+                adjoints.erase(found);
+            }
+        }
+        if(s < spilled.size() && !segmentLeaves.empty()){
+            const Segment& seg = spilled[s];
+            checkpoint.seekp(seg.offset + seg.nEntries * sizeof(Entry));
+            checkpoint.write((const char*)&segmentLeaves[0], seg.nLeaves * sizeof(Leaf));
+            H_ASSERT(!checkpoint.fail(), "Could not write adjoint checkpoint file " + checkpointPath);
+        }
+    }
+}
+
+size_t AdjointTape::size() const{
+    return spilledEntries + entries.size();
+}
+
+size_t AdjointTape::entriesInMemory() const{
+    return entries.size();
+}
+
+size_t AdjointTape::leafCount() const{
+    return spilledLeaves + leaves.size();
+}
+
+vector<AdjointTape::Leaf> AdjointTape::getLeaves(){
+    vector<Leaf> all;
+    all.reserve(leafCount());
+    vector<Leaf> segmentLeaves;
+    for(size_t s = 0; s < spilled.size(); ++s){
+        readLeaves(spilled[s], segmentLeaves);
+        all.insert(all.end(), segmentLeaves.begin(), segmentLeaves.end());
+    }
+    all.insert(all.end(), leaves.begin(), leaves.end());
+    return all;
+}
+
+double AdjointTape::getSensitivity(CarbonTracker& ct){
+    // segments are in node order - the leaf is in the first one that ends after its node
+    size_t s = 0;
+    size_t hi = spilled.size();
+    while(s < hi){
+        size_t mid = (s + hi) / 2;
+        if(spilled[mid].endNode <= ct.tapeNode){
+            s = mid + 1;
+        }
+        else{
+            hi = mid;
+        }
+    }
+    const vector<Leaf>* found = &leaves;
+    vector<Leaf> segmentLeaves;
+    if(s < spilled.size()){
+        readLeaves(spilled[s], segmentLeaves);
+        found = &segmentLeaves;
+    }
+    size_t l = findLeaf(*found, ct.tapeNode);
+    H_ASSERT(l < found->size(), "Value is not a leaf of the adjoint tape");
+    return (*found)[l].sensitivity;
+}
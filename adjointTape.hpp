@@ -0,0 +1,186 @@
+#ifndef ADJOINTTAPE_HPP
+#define ADJOINTTAPE_HPP
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "carbonTracker.hpp"
+
+using namespace std;
+
+  /**
+   * \brief AdjointTape Class: records the linear mixing steps made by CarbonTracker operators so the sensitivity
+   * of one target pool to every earlier flux can be found in a single reverse sweep
+   * 
+   * Attach with CarbonTracker::attachTape. Pools created (or watched) while recording and every fluxFromTrackerPool
+   * become leaves; operator+, operator-, operator* and operator/ become entries out = wa*a + wb*b over origin masses,
+   * with each flux's origin fractions held at their recorded values. Entries and leaves are spilled to a checkpoint
+   * file one segment at a time, so memory stays bounded on long runs and the sweep streams the segments back in reverse.
+   * Sensitivities go through the flux fractions, so tracking must stay on while the tape is attached - attaching
+   * throws without it, and recording a flux after stopTracking throws too
+   */
+  class AdjointTape{
+   public:
+
+    // Kind of value a leaf stands for
+    enum LeafKind {
+      INPUT, FLUX
+    };
+
+    // A value the target can be sensitive to
+    struct Leaf {
+      uint32_t node;                          // tape node of the value
+      uint32_t timestep;                      // timestep set with setTimestep when it was recorded
+      double amount;                          // carbon in the pool or flux (pg C)
+      double fracs[CarbonTracker::LAST];      // origin fractions when it was recorded
+      double sensitivity;                     // d target / d amount - set by reverse
+      uint8_t kind;                           // LeafKind
+      uint8_t pool;                           // pool it is in or was taken from
+    };
+
+    // One mixing step: node out = wa * a + wb * b over origin masses
+    struct Entry {
+      double wa;
+      double wb;
+      uint32_t out;
+      uint32_t a;
+      uint32_t b;
+    };
+
+    // marks a value that isn't on the tape
+    static const uint32_t NO_NODE = 0xFFFFFFFF;
+
+   private:
+
+    // Where a spilled segment sits in the checkpoint file - its entries, then its leaves
+    struct Segment {
+      uint64_t offset;
+      uint32_t nEntries;
+      uint32_t nLeaves;
+      uint32_t endNode;   // first node recorded after the segment
+    };
+
+    // entries and leaves (in node order) of the current segment
+    vector<Entry> entries;
+    vector<Leaf> leaves;
+
+    // file full segments are spilled to and its name
+    fstream checkpoint;
+    string checkpointPath;
+
+    // most entries or leaves held in memory before the segment is spilled
+    size_t segmentEntries;
+
+    // spilled segments in recording order, their total entry and leaf counts and the end of the file
+    vector<Segment> spilled;
+    size_t spilledEntries;
+    size_t spilledLeaves;
+    uint64_t checkpointEnd;
+
+    // next free node
+    uint32_t nextNode;
+
+    // current timestep stamped on new leaves
+    uint32_t timestep;
+
+    // Make the copy constructs private and undefined - only one owner per checkpoint file
+    AdjointTape(const AdjointTape&);
+    AdjointTape& operator=(const AdjointTape&);
+
+    /**
+      * \brief writes the current segment's entries and leaves to the checkpoint file and clears them
+      */
+    void spill();
+
+    /**
+      * \brief reads a spilled segment's leaves back
+      */
+    void readLeaves(const Segment& seg, vector<Leaf>& out);
+
+   public:
+
+    /**
+      * \brief constructor
+      * \param checkpointPath file spilled segments are written to - one per tape, so two tapes (or processes)
+      *        can't share it. Removed by the destructor
+      * \param segmentEntries number of entries (or leaves) kept in memory before a segment is spilled
+      */
+    AdjointTape(const string& checkpointPath, size_t segmentEntries = 65536);
+
+    /**
+      * \brief destructor - removes the checkpoint file
+      */
+    ~AdjointTape();
+
+    /**
+      * \brief sets the timestep stamped on every following leaf
+      * \param t timestep (e.g. model year or step number)
+      */
+    void setTimestep(uint32_t t);
+
+    /**
+      * \brief puts a pool created before recording started on the tape as an input
+      * \param ct pool to watch
+      */
+    void watch(CarbonTracker& ct);
+
+    /**
+      * \brief records a new leaf
+      * \param kind INPUT for pools, FLUX for fluxes
+      * \param pool pool the value is in or was taken from
+      * \param amount carbon in pg C
+      * \param fracs LAST origin fractions of the value
+      * \return node of the leaf
+      */
+    uint32_t recordLeaf(LeafKind kind, CarbonTracker::Pool pool, double amount, const double* fracs);
+
+    /**
+      * \brief records a mixing step out = wa * a + wb * b
+      * \param a node of the first operand (NO_NODE if not on the tape)
+      * \param wa weight of the first operand
+      * \param b node of the second operand (NO_NODE if not on the tape)
+      * \param wb weight of the second operand
+      * \return node of the result, NO_NODE if neither operand is on the tape
+      */
+    uint32_t record(uint32_t a, double wa, uint32_t b, double wb);
+
+    /**
+      * \brief back-propagates one target through the whole tape and sets every leaf's sensitivity
+      * \param target pool (at the time of interest) to find the sensitivity of
+      * \param originWeights LAST weights of the target's origin carbon - NULL to use its total carbon
+      */
+    void reverse(CarbonTracker& target, const double* originWeights = NULL);
+
+    /**
+      * \brief getter for number of mixing steps recorded
+      * \return entry count (in memory and spilled)
+      */
+    size_t size() const;
+
+    /**
+      * \brief getter for number of mixing steps currently held in memory
+      * \return entry count of the current segment
+      */
+    size_t entriesInMemory() const;
+
+    /**
+      * \brief getter for number of leaves recorded
+      * \return leaf count (in memory and spilled)
+      */
+    size_t leafCount() const;
+
+    /**
+      * \brief all leaves in the order they were recorded - reads the spilled ones back, so meant for reports
+      * \return leaves with sensitivities from the last reverse sweep
+      */
+    vector<Leaf> getLeaves();
+
+    /**
+      * \brief getter for the sensitivity found for a pool or flux by the last reverse sweep
+      * \param ct pool or flux that was recorded as a leaf
+      * \return d target / d amount of ct
+      */
+    double getSensitivity(CarbonTracker& ct);
+  };
+
+#endif
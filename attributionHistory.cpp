@@ -0,0 +1,120 @@
+#include <algorithm>
+#include <vector>
+#include "attributionHistory.hpp"
+
+using namespace std;
+
+AttributionHistory::PeakTree::PeakTree() : cap(0){
+}
+
+uint32_t AttributionHistory::PeakTree::better(uint32_t a, uint32_t b) const{
+    return values[b] > values[a] ? b : a;
+}
+
+void AttributionHistory::PeakTree::push(double v){
+    values.push_back(v);
+    if(values.size() > cap){
+        // out of leaves - double and rebuild, amortized O(1) per push
+        cap = cap == 0 ? 1 : cap * 2;
+        tree.assign(2 * cap, 0);
+        for(size_t i = 0; i < values.size(); ++i){
+            tree[cap + i] = i;
+        }
+        for(size_t i = cap - 1; i > 0; --i){
+            tree[i] = better(tree[2 * i], tree[2 * i + 1]);
+        }
+        return;
+    }
+    size_t i = cap + values.size() - 1;
+    tree[i] = values.size() - 1;
+    for(i /= 2; i > 0; i /= 2){
+        tree[i] = better(tree[2 * i], tree[2 * i + 1]);
+    }
+}
+
+uint32_t AttributionHistory::PeakTree::argmax(size_t lo, size_t hi) const{
+    // leaves past values.size() still hold index 0, so only ever look inside [lo, hi)
+    uint32_t best = lo;
+    for(lo += cap, hi += cap; lo < hi; lo /= 2, hi /= 2){
+        if(lo & 1){
+            best = better(best, tree[lo++]);
+        }
+        if(hi & 1){
+            best = better(best, tree[--hi]);
+        }
+    }
+    return best;
+}
+
+double AttributionHistory::PeakTree::at(size_t i) const{
+    return values[i];
+}
+
+
+AttributionHistory::AttributionHistory(){
+    for(int p = 0; p < CarbonTracker::LAST; ++p){
+        series[p].totalPrefix.push_back(0);
+        for(int o = 0; o < CarbonTracker::LAST; ++o){
+            series[p].fracPrefix[o].push_back(0);
+            series[p].carbonPrefix[o].push_back(0);
+        }
+    }
+}
+
+void AttributionHistory::record(double time, CarbonTracker& ct){
+    CarbonTracker::Pool pool = ct.getHomePool();
+    H_ASSERT(pool != CarbonTracker::LAST, "Can only record the history of a pool");
+    PoolSeries& s = series[pool];
+    H_ASSERT(s.times.empty() || time > s.times.back(), "History snapshots must be recorded in time order");
+
+    double total = ct.getTotalCarbon().value(Hector::U_PGC);
+    double* fracs = ct.getOriginFracs();
+    s.times.push_back(time);
+    s.totalPrefix.push_back(s.totalPrefix.back() + total);
+    for(int o = 0; o < CarbonTracker::LAST; ++o){
+        s.fracPrefix[o].push_back(s.fracPrefix[o].back() + fracs[o]);
+        s.carbonPrefix[o].push_back(s.carbonPrefix[o].back() + total * fracs[o]);
+        s.carbonPeaks[o].push(total * fracs[o]);
+    }
+}
+
+size_t AttributionHistory::size(CarbonTracker::Pool pool) const{
+    return series[pool].times.size();
+}
+
+void AttributionHistory::range(CarbonTracker::Pool pool, double t0, double t1, size_t& lo, size_t& hi) const{
+    H_ASSERT(pool != CarbonTracker::LAST, "LAST is not a sub-pool of carbon, it is just a marker for the end of the enum");
+    const vector<double>& times = series[pool].times;
+    lo = lower_bound(times.begin(), times.end(), t0) - times.begin();
+    hi = upper_bound(times.begin(), times.end(), t1) - times.begin();
+    H_ASSERT(lo < hi, "No history recorded in that time range");
+}
+
+double AttributionHistory::meanFraction(CarbonTracker::Pool pool, CarbonTracker::Pool origin, double t0, double t1) const{
+    size_t lo, hi;
+    range(pool, t0, t1, lo, hi);
+    const vector<double>& prefix = series[pool].fracPrefix[origin];
+    return (prefix[hi] - prefix[lo]) / (hi - lo);
+}
+
+double AttributionHistory::carbonFraction(CarbonTracker::Pool pool, CarbonTracker::Pool origin, double t0, double t1) const{
+    size_t lo, hi;
+    range(pool, t0, t1, lo, hi);
+    const PoolSeries& s = series[pool];
+    double total = s.totalPrefix[hi] - s.totalPrefix[lo];
+    H_ASSERT(total != 0, "Pool held no carbon in that time range");
+    return (s.carbonPrefix[origin][hi] - s.carbonPrefix[origin][lo]) / total;
+}
+
+double AttributionHistory::peakTime(CarbonTracker::Pool pool, CarbonTracker::Pool origin, double t0, double t1) const{
+    size_t lo, hi;
+    range(pool, t0, t1, lo, hi);
+    return series[pool].times[series[pool].carbonPeaks[origin].argmax(lo, hi)];
+}
+
+Hector::unitval AttributionHistory::peakCarbon(CarbonTracker::Pool pool, CarbonTracker::Pool origin, double t0, double t1) const{
+    size_t lo, hi;
+    range(pool, t0, t1, lo, hi);
+    const PeakTree& peaks = series[pool].carbonPeaks[origin];
+    return Hector::unitval(peaks.at(peaks.argmax(lo, hi)), Hector::U_PGC);
+}
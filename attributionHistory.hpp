@@ -0,0 +1,118 @@
+#ifndef ATTRIBUTIONHISTORY_HPP
+#define ATTRIBUTIONHISTORY_HPP
+#include <vector>
+#include <stdint.h>
+#include "carbonTracker.hpp"
+
+using namespace std;
+
+  /**
+   * \brief AttributionHistory Class: time-indexed store of every pool's origin fractions over a run
+   * 
+   * Snapshots are appended with record (during or after a simulation) and kept as prefix sums plus one
+   * max segment tree per pool and origin, so range questions such as "what fraction of ATMOSPHERE came from
+   * SOIL in 1990-2000" or "when did DEEPOCEAN carbon peak in TOPOCEAN" take O(log T) instead of a scan
+   */
+  class AttributionHistory{
+   private:
+
+    /**
+     * \brief append-only segment tree that answers "index of the largest value in [lo, hi)"
+     */
+    class PeakTree{
+     private:
+      // values in append order
+      vector<double> values;
+
+      // bottom up tree of indices into values - leaves start at cap
+      vector<uint32_t> tree;
+
+      // number of leaves - always a power of two
+      size_t cap;
+
+      // index of the larger of two values (earlier index wins ties)
+      uint32_t better(uint32_t a, uint32_t b) const;
+
+     public:
+      PeakTree();
+      void push(double v);
+      uint32_t argmax(size_t lo, size_t hi) const;
+      double at(size_t i) const;
+    };
+
+    /**
+     * \brief history of one pool - entry i of the prefix vectors is the sum over the first i snapshots
+     */
+    struct PoolSeries{
+      vector<double> times;
+      vector<double> totalPrefix;
+      vector<double> fracPrefix[CarbonTracker::LAST];
+      vector<double> carbonPrefix[CarbonTracker::LAST];
+      PeakTree carbonPeaks[CarbonTracker::LAST];
+    };
+
+    // one series per pool, indexed by CarbonTracker::Pool
+    PoolSeries series[CarbonTracker::LAST];
+
+    /**
+      * \brief finds the snapshots of a pool with t0 <= time <= t1 - asserts the range isn't empty
+      * \param lo set to the first snapshot in range
+      * \param hi set to one past the last snapshot in range
+      */
+    void range(CarbonTracker::Pool pool, double t0, double t1, size_t& lo, size_t& hi) const;
+
+   public:
+
+    /**
+      * \brief constructor - starts with no snapshots
+      */
+    AttributionHistory();
+
+    /**
+      * \brief appends a snapshot of a pool - times must increase for each pool
+      * \param time model time of the snapshot (e.g. year)
+      * \param ct pool to record - its home pool decides which series it is stored in
+      */
+    void record(double time, CarbonTracker& ct);
+
+    /**
+      * \brief getter for number of snapshots recorded for a pool
+      * \param pool pool to query
+      * \return snapshot count
+      */
+    size_t size(CarbonTracker::Pool pool) const;
+
+    /**
+      * \brief average origin fraction of a pool over the snapshots in [t0, t1]
+      * \param pool pool to query
+      * \param origin origin of the carbon
+      * \return unweighted mean of the fraction
+      */
+    double meanFraction(CarbonTracker::Pool pool, CarbonTracker::Pool origin, double t0, double t1) const;
+
+    /**
+      * \brief carbon weighted origin fraction of a pool over the snapshots in [t0, t1]
+      * \param pool pool to query
+      * \param origin origin of the carbon
+      * \return summed carbon from origin divided by summed total carbon
+      */
+    double carbonFraction(CarbonTracker::Pool pool, CarbonTracker::Pool origin, double t0, double t1) const;
+
+    /**
+      * \brief time at which a pool held the most carbon from an origin within [t0, t1]
+      * \param pool pool to query
+      * \param origin origin of the carbon
+      * \return time of the earliest peak snapshot
+      */
+    double peakTime(CarbonTracker::Pool pool, CarbonTracker::Pool origin, double t0, double t1) const;
+
+    /**
+      * \brief most carbon from an origin a pool held within [t0, t1]
+      * \param pool pool to query
+      * \param origin origin of the carbon
+      * \return unitval with units (pg C)
+      */
+    Hector::unitval peakCarbon(CarbonTracker::Pool pool, CarbonTracker::Pool origin, double t0, double t1) const;
+  };
+
+#endif
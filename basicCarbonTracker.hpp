@@ -0,0 +1,197 @@
+#ifndef BASICCARBONTRACKER_HPP
+#define BASICCARBONTRACKER_HPP
+#include "carbonTracker.hpp"
+#include "trackerStats.hpp"
+
+using namespace std;
+
+  /**
+   * \brief BasicCarbonTracker Class: CarbonTracker arithmetic over any unitval-like value type
+   * 
+   * V is a unitval variant that carries several lanes per value (e.g. Hector::dualUnitval for derivatives).
+   * It must provide V::lanes_type (the unitless lane type, with +, -, * and / ), V(lanes_type, unit_types),
+   * lanes() and units(), and foldLanes, laneValue and moveLane for lanes_type. Origin fractions and the untracked
+   * bucket are lanes_type too, so they carry every lane as well. Units are checked once per operation and the
+   * mixing loops run over whole lane arrays.
+   * 
+   * Runs the same tracking rules as CarbonTracker - the rule templates in CarbonTracker do the work for both, so
+   * tracking off, tracking masks and top-K limits give the same fractions as a CarbonTracker run, lane by lane.
+   * It does not journal or tape.
+   */
+  template<class V>
+  class BasicCarbonTracker{
+   public:
+
+    typedef typename V::lanes_type lanes_type;
+
+   private:
+
+    // Total amount of carbon in the pool - in petagrams carbon (U-PGC)
+    V totalCarbon;
+
+    // fraction of the carbon from each origin, indexed by CarbonTracker::Pool
+    lanes_type originFracs[CarbonTracker::LAST];
+
+    // pool this object belongs to (or, for a flux, the pool it was taken from) - LAST if unknown
+    CarbonTracker::Pool homePool;
+
+    // fraction of the carbon from origins that aren't tracked, or held in a pool that isn't tracked
+    lanes_type untrackedFrac;
+
+    /**
+      *\brief parameterized constructor from existing fractions - only for use by the operators
+      */
+    BasicCarbonTracker(const V& totC, const lanes_type* fracs, CarbonTracker::Pool home, const lanes_type& untracked)
+        : totalCarbon(totC), homePool(home), untrackedFrac(untracked){
+        if(!CT_VALID(totC.units() == Hector::U_PGC, WRONG_UNITS, "Wrong Units. Carbin tracker only accepts U_PGC")){
+            totalCarbon = V(totC.lanes(), Hector::U_PGC);
+        }
+        for(int i = 0; i < CarbonTracker::LAST; ++i){
+            originFracs[i] = fracs[i];
+        }
+        if(CarbonTracker::isTracking()){
+            double drift = CarbonTracker::fracDrift(originFracs, untrackedFrac);
+            CT_STAT(noteDrift(drift));
+            CT_VALID(drift < CarbonTracker::FRACTION_TOLERANCE, FRACTION_DRIFT, "Pool fractions don't add up to 1.");
+            CarbonTracker::foldToTopK(originFracs, untrackedFrac, homePool);
+        }
+    }
+
+   public:
+
+    /**
+      *\brief parameterized constructor - initialize pools of carbon with pg carbon
+      *\param totC value (units pg C) that expresses total amount of carbon in the pool
+      *\param subPool origin of all carbon in the pool at time of creation
+      */
+    BasicCarbonTracker(const V& totC, CarbonTracker::Pool subPool) : totalCarbon(totC), homePool(subPool){
+        CT_VALID(subPool != CarbonTracker::LAST, BAD_POOL, "LAST is not a sub-pool of carbon, it is just a marker for the end of the enum");
+        if(!CT_VALID(totC.units() == Hector::U_PGC, WRONG_UNITS, "Wrong Units. Carbin tracker only accepts U_PGC")){
+            totalCarbon = V(totC.lanes(), Hector::U_PGC);
+        }
+        CarbonTracker::initFracs(originFracs, untrackedFrac, subPool);
+    }
+
+    /**
+      * \brief addition of a flux - mixes origin fractions by carbon when tracking
+      */
+    BasicCarbonTracker operator+(const BasicCarbonTracker& flux) const{
+        if(!CT_VALID(flux.totalCarbon.units() == totalCarbon.units(), WRONG_UNITS, "Only carbon can be used in carbon tracker!")){
+            return *this;
+        }
+        V totC = totalCarbon + flux.totalCarbon;
+        lanes_type newOrigins[CarbonTracker::LAST];
+        lanes_type newUntracked;
+        CT_VALID(CarbonTracker::addFracs(newOrigins, newUntracked, originFracs, untrackedFrac, totalCarbon.lanes(), homePool,
+                                         flux.originFracs, flux.untrackedFrac, flux.totalCarbon.lanes(), totC.lanes()),
+                 BAD_POOL, "You can only add a flux to a pool, not a pool to a pool!");
+        return BasicCarbonTracker(totC, newOrigins, homePool, newUntracked);
+    }
+
+    /**
+      * \brief subtraction of a flux - removes carbon by the flux's fractions when tracking
+      */
+    BasicCarbonTracker operator-(const BasicCarbonTracker& flux) const{
+        if(!CarbonTracker::isTracking() || !CarbonTracker::tracksPool(homePool)){
+            return *this - flux.totalCarbon;
+        }
+        if(!CT_VALID(flux.totalCarbon.units() == Hector::U_PGC, WRONG_UNITS, "Only carbon can be used in carbon tracker!")){
+            return *this;
+        }
+        V totC = totalCarbon - flux.totalCarbon;
+        lanes_type newOrigins[CarbonTracker::LAST];
+        lanes_type newUntracked;
+        CarbonTracker::mixPool(newOrigins, newUntracked, originFracs, untrackedFrac, totalCarbon.lanes(), flux.originFracs, 
+                               flux.untrackedFrac, lanes_type(0.0) - flux.totalCarbon.lanes(), totC.lanes());
+        return BasicCarbonTracker(totC, newOrigins, homePool, newUntracked);
+    }
+
+    /**
+      * \brief subtraction of carbon evenly from every origin
+      */
+    BasicCarbonTracker operator-(const V& flux) const{
+        if(!CT_VALID(flux.units() == Hector::U_PGC, WRONG_UNITS, "Only carbon can be used in carbon tracker!")){
+            return *this;
+        }
+        return BasicCarbonTracker(totalCarbon - flux, originFracs, homePool, untrackedFrac);
+    }
+
+    /**
+      * \brief scaling of the pool's carbon - fractions are unchanged
+      */
+    BasicCarbonTracker operator*(const double d) const{
+        BasicCarbonTracker ct(*this);
+        ct.totalCarbon = totalCarbon * d;
+        return ct;
+    }
+
+    /**
+      * \brief division of the pool's carbon - fractions are unchanged
+      */
+    BasicCarbonTracker operator/(const double d) const{
+        if(!CT_VALID(d != 0, DIVIDE_BY_ZERO, "No dividing by 0!")){
+            return *this;
+        }
+        BasicCarbonTracker ct(*this);
+        ct.totalCarbon = totalCarbon / d;
+        return ct;
+    }
+
+    /**
+      * \brief makes a flux of 'flux' carbon with the same fractions as this pool - all 0 when not tracking, so
+      *        adding it leaves the fractions of the pool it goes to alone
+      */
+    BasicCarbonTracker fluxFromTrackerPool(const V& flux) const{
+        BasicCarbonTracker ct(*this);
+        ct.totalCarbon = CT_VALID(flux.units() == Hector::U_PGC, WRONG_UNITS, "Flux must be in units U_PGC for carbon tracker") 
+                         ? flux : V(flux.lanes(), Hector::U_PGC);
+        if(!CarbonTracker::isTracking()){
+            for(int i = 0; i < CarbonTracker::LAST; ++i){
+                ct.originFracs[i] = lanes_type(0.0);
+            }
+            ct.untrackedFrac = lanes_type(0.0);
+        }
+        return ct;
+    }
+
+    void setTotalCarbon(const V& tCarbon){
+        if(CT_VALID(tCarbon.units() == Hector::U_PGC, WRONG_UNITS, "Carbon Tracker only accepts unitvals with units U_PGC")){
+            totalCarbon = tCarbon;
+        }
+    }
+
+    V getTotalCarbon() const{
+        return totalCarbon;
+    }
+
+    const lanes_type* getOriginFracs() const{
+        return originFracs;
+    }
+
+    CarbonTracker::Pool getHomePool() const{
+        return homePool;
+    }
+
+    V getPoolCarbon(CarbonTracker::Pool origin) const{
+        H_ASSERT(origin != CarbonTracker::LAST, "LAST is not a sub-pool of carbon, it is just a marker for the end of the enum");
+        return V(totalCarbon.lanes() * originFracs[origin], totalCarbon.units());
+    }
+
+    const lanes_type& getUntrackedFrac() const{
+        return untrackedFrac;
+    }
+
+    V getUntrackedCarbon() const{
+        return V(totalCarbon.lanes() * untrackedFrac, totalCarbon.units());
+    }
+  };
+
+  /**
+    * \brief multiplication between double and BasicCarbonTracker object
+    */ 
+  template<class V>
+  inline BasicCarbonTracker<V> operator*(const double d, const BasicCarbonTracker<V>& ct){
+    return ct * d;
+  }
+
+#endif
@@ -0,0 +1,175 @@
+#ifndef BATCHUNITVAL_HPP
+#define BATCHUNITVAL_HPP
+/*
+ *  batchUnitval.hpp - a fixed number of ensemble members under one unit
+ *
+ *  Every lane is one ensemble member. Members that share a flux topology
+ *  advance together: the unit check (and, in BasicCarbonTracker, the
+ *  tracking branch) is paid once per batch and the lane loops vectorize.
+ */
+
+#include <sstream>
+
+#include "unitval.hpp"
+
+namespace Hector {
+
+/*! \brief N ensemble member values with no units.
+ */
+template<int N>
+struct batch {
+    double v[N];
+
+    batch() { for( int i = 0; i < N; ++i ) v[i] = 0.0; }
+    batch( double x ) { for( int i = 0; i < N; ++i ) v[i] = x; }
+    batch( const double* x ) { for( int i = 0; i < N; ++i ) v[i] = x[i]; }
+};
+
+template<int N>
+inline batch<N> operator+ ( const batch<N>& lhs, const batch<N>& rhs ) {
+    batch<N> r;
+    for( int i = 0; i < N; ++i ) r.v[i] = lhs.v[i] + rhs.v[i];
+    return r;
+}
+
+template<int N>
+inline batch<N> operator- ( const batch<N>& lhs, const batch<N>& rhs ) {
+    batch<N> r;
+    for( int i = 0; i < N; ++i ) r.v[i] = lhs.v[i] - rhs.v[i];
+    return r;
+}
+
+template<int N>
+inline batch<N> operator* ( const batch<N>& lhs, const batch<N>& rhs ) {
+    batch<N> r;
+    for( int i = 0; i < N; ++i ) r.v[i] = lhs.v[i] * rhs.v[i];
+    return r;
+}
+
+template<int N>
+inline batch<N> operator/ ( const batch<N>& lhs, const batch<N>& rhs ) {
+    batch<N> r;
+    for( int i = 0; i < N; ++i ) r.v[i] = lhs.v[i] / rhs.v[i];
+    return r;
+}
+
+template<int N>
+inline batch<N> operator* ( const batch<N>& lhs, const double rhs ) {
+    batch<N> r;
+    for( int i = 0; i < N; ++i ) r.v[i] = lhs.v[i] * rhs;
+    return r;
+}
+
+template<int N>
+inline batch<N> operator* ( const double lhs, const batch<N>& rhs ) {
+    return rhs * lhs;
+}
+
+template<int N>
+inline batch<N> operator/ ( const batch<N>& lhs, const double rhs ) {
+    return lhs * ( 1.0 / rhs );
+}
+
+/*! \brief Lanes for the carbon tracking rules: every member is its own
+ *  run, so each picks and folds its own origins.
+ */
+template<int N>
+inline int foldLanes( const batch<N>& ) {
+    return N;
+}
+
+template<int N>
+inline double laneValue( const batch<N>& f, int lane ) {
+    return f.v[lane];
+}
+
+template<int N>
+inline void moveLane( batch<N>& to, batch<N>& from, int lane ) {
+    to.v[lane] += from.v[lane];
+    from.v[lane] = 0.0;
+}
+
+/*! \brief A unitval holding N ensemble members that share one unit tag.
+ */
+template<int N>
+class batchUnitval {
+
+    batch<N>    val;
+    unit_types  valUnits;
+
+public:
+    typedef batch<N> lanes_type;
+
+    batchUnitval() : valUnits( U_UNDEFINED ) {}
+    batchUnitval( double v, unit_types u ) : val( v ), valUnits( u ) {}
+    batchUnitval( const double* v, unit_types u ) : val( v ), valUnits( u ) {}
+    batchUnitval( const batch<N>& v, unit_types u ) : val( v ), valUnits( u ) {}
+
+    /*! \brief Get one member's value. Caller has to provide assumed units, as a check.
+     */
+    double value( int member, unit_types u ) const {
+        H_ASSERT( u==valUnits, "variable is not of this type.  Expected: " + unitval::unitsName(valUnits) +
+                 "; got: " + unitval::unitsName(u) );
+        return val.v[member];
+    }
+    unitval member( int m ) const { return unitval( val.v[m], valUnits ); }
+    const batch<N>& lanes() const { return val; }
+    unit_types units() const { return valUnits; }
+};
+
+template<int N>
+inline batchUnitval<N> operator+ ( const batchUnitval<N>& lhs, const batchUnitval<N>& rhs ) {
+    H_ASSERT( lhs.units()==rhs.units(), "units mismatch" );
+    return batchUnitval<N>( lhs.lanes() + rhs.lanes(), lhs.units() );
+}
+
+template<int N>
+inline batchUnitval<N> operator- ( const batchUnitval<N>& lhs, const batchUnitval<N>& rhs ) {
+    H_ASSERT( lhs.units()==rhs.units(), "units mismatch" );
+    return batchUnitval<N>( lhs.lanes() - rhs.lanes(), lhs.units() );
+}
+
+template<int N>
+inline batchUnitval<N> operator* ( const batchUnitval<N>& lhs, const batch<N>& rhs ) {
+    return batchUnitval<N>( lhs.lanes() * rhs, lhs.units() );
+}
+
+template<int N>
+inline batchUnitval<N> operator* ( const batch<N>& lhs, const batchUnitval<N>& rhs ) {
+    return batchUnitval<N>( lhs * rhs.lanes(), rhs.units() );
+}
+
+template<int N>
+inline batchUnitval<N> operator* ( const batchUnitval<N>& lhs, const double rhs ) {
+    return batchUnitval<N>( lhs.lanes() * rhs, lhs.units() );
+}
+
+template<int N>
+inline batchUnitval<N> operator* ( const double lhs, const batchUnitval<N>& rhs ) {
+    return batchUnitval<N>( rhs.lanes() * lhs, rhs.units() );
+}
+
+template<int N>
+inline batchUnitval<N> operator/ ( const batchUnitval<N>& lhs, const double rhs ) {
+    return batchUnitval<N>( lhs.lanes() / rhs, lhs.units() );
+}
+
+/*! \brief Divide two batchUnitvals member by member. Must be of the same type, returning unitless lanes.
+ */
+template<int N>
+inline batch<N> operator/ ( const batchUnitval<N>& lhs, const batchUnitval<N>& rhs ) {
+    H_ASSERT( lhs.units()==rhs.units(), "units mismatch" );
+    return lhs.lanes() / rhs.lanes();
+}
+
+template<int N>
+inline std::ostream& operator<<( std::ostream &out, const batchUnitval<N> &x ) {
+    out << "[";
+    for( int i = 0; i < N; ++i ) out << ( i ? " " : "" ) << x.lanes().v[i];
+    out << "] " << unitval::unitsName( x.units() );
+    return out;
+}
+
+}
+
+#endif
@@ -0,0 +1,151 @@
+#include "../carbonTracker.hpp"
+#include "../fluxReduction.hpp"
+#include "../textBuffer.hpp"
+#include "../tracer.hpp"
+#include <chrono>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/*
+ * Times the most common pattern in the carbon-cycle code - a flux taken from one pool and moved to another -
+ * against the same arithmetic on raw unitvals. Build with and without CARBONTRACKER_NO_TRACKING (make bench)
+ * to compare tracked, tracking-off and tracking-compiled-out costs.
+ */
+
+const int STEPS = 10000000;
+
+double elapsedNs(chrono::steady_clock::time_point start){
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / STEPS;
+}
+
+double benchUnitval(){
+    Hector::unitval soil(1000, Hector::U_PGC);
+    Hector::unitval atmos(1000, Hector::U_PGC);
+    Hector::unitval flux(1e-6, Hector::U_PGC);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for(int i = 0; i < STEPS; ++i){
+        soil = soil - flux;
+        atmos = atmos + flux;
+    }
+    double ns = elapsedNs(start);
+    cout << "unitval:       " << ns << " ns/transfer (" << soil + atmos << ")" << endl;
+    return ns;
+}
+
+double benchTracker(const char* label){
+    Hector::unitval carbon(1000, Hector::U_PGC);
+    CarbonTracker soil(carbon, CarbonTracker::SOIL);
+    CarbonTracker atmos(carbon, CarbonTracker::ATMOSPHERE);
+    Hector::unitval amount(1e-6, Hector::U_PGC);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for(int i = 0; i < STEPS; ++i){
+        CarbonTracker flux = soil.fluxFromTrackerPool(amount);
+        soil = soil - flux;
+        atmos = atmos + flux;
+    }
+    double ns = elapsedNs(start);
+    cout << label << ns << " ns/transfer (" << soil.getTotalCarbon() + atmos.getTotalCarbon() << ")" << endl;
+    return ns;
+}
+
+double benchTransfer(const char* label){
+    Hector::unitval carbon(1000, Hector::U_PGC);
+    CarbonTracker soil(carbon, CarbonTracker::SOIL);
+    CarbonTracker atmos(carbon, CarbonTracker::ATMOSPHERE);
+    Hector::unitval amount(1e-6, Hector::U_PGC);
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for(int i = 0; i < STEPS; ++i){
+        CarbonTracker::transfer(soil, atmos, amount);
+    }
+    double ns = elapsedNs(start);
+    cout << label << ns << " ns/transfer (" << soil.getTotalCarbon() + atmos.getTotalCarbon() << ")" << endl;
+    return ns;
+}
+
+// cost of one TraceSpan - rounds stay under a thread's buffer so nothing is dropped
+double benchSpan(){
+    const int ROUND = Tracer::THREAD_EVENTS / 2;
+    double total = 0;
+    for(int done = 0; done < STEPS; done += ROUND){
+        Tracer::clear();
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        for(int i = 0; i < ROUND; ++i){
+            TraceSpan span("bench span", "bench");
+        }
+        total += chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+    }
+    double ns = total / (STEPS / ROUND * ROUND);
+    Tracer::clear();
+    cout << "trace span:    " << ns << " ns/span" << endl;
+    return ns;
+}
+
+// text output of a pool snapshot - through a reused buffer and through operator<<
+void benchFormat(){
+    const int ROUNDS = STEPS / 10;
+    CarbonTracker soil(Hector::unitval(1000, Hector::U_PGC), CarbonTracker::SOIL);
+    CarbonTracker atmos(Hector::unitval(600, Hector::U_PGC), CarbonTracker::ATMOSPHERE);
+    CarbonTracker::transfer(soil, atmos, Hector::unitval(1.0 / 3, Hector::U_PGC));
+    TextBuffer buffer;
+    size_t chars = 0;
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    for(int i = 0; i < ROUNDS; ++i){
+        buffer.clear();
+        buffer.append(atmos);
+        chars += buffer.size();
+    }
+    double bufferNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / ROUNDS;
+    ostringstream out;
+    start = chrono::steady_clock::now();
+    for(int i = 0; i < ROUNDS; ++i){
+        out.str("");
+        out << atmos;
+        chars += out.tellp();
+    }
+    double streamNs = chrono::duration<double, nano>(chrono::steady_clock::now() - start).count() / ROUNDS;
+    cout << "snapshot text: " << bufferNs << " ns buffer, " << streamNs << " ns operator<< (" << chars << " chars)" << endl;
+}
+
+// one flux per cell combined into one pool - serial against every core, same bits either way
+void benchReduce(){
+    const int CELLS = 1 << 20;
+    CarbonTracker soil(Hector::unitval(1e9, Hector::U_PGC), CarbonTracker::SOIL);
+    vector<CarbonTracker> fluxes(CELLS, soil.fluxFromTrackerPool(Hector::unitval(1e-3, Hector::U_PGC)));
+    int cores = thread::hardware_concurrency() ? thread::hardware_concurrency() : 1;
+    double ms[2];
+    int threads[2] = {1, cores};
+    for(int run = 0; run < 2; ++run){
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        CarbonTracker total = FluxReduction::reduce(fluxes, threads[run]);
+        ms[run] = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        cout << "reduce " << CELLS << " fluxes, " << threads[run] << " threads: " << ms[run] << " ms (" 
+             << total.getTotalCarbon() << ")" << endl;
+    }
+    cout << "reduction speedup: " << ms[0] / ms[1] << endl;
+}
+
+int main(int argc, char* argv[]){
+#ifdef CARBONTRACKER_NO_TRACKING
+    cout << "Tracking compiled out" << endl;
+    double base = benchUnitval();
+    double off = benchTracker("CarbonTracker: ");
+    double fused = benchTransfer("transfer:      ");
+    cout << "ratio to unitval: " << off / base << ", transfer " << fused / base << endl;
+#else
+    cout << "Tracking compiled in" << endl;
+    double base = benchUnitval();
+    double off = benchTracker("tracking off:  ");
+    CarbonTracker::startTracking();
+    double on = benchTracker("tracking on:   ");
+    double fused = benchTransfer("transfer on:   ");
+    CarbonTracker::stopTracking();
+    cout << "ratio to unitval: off " << off / base << ", on " << on / base << ", transfer on " << fused / base << endl;
+#endif
+    benchSpan();
+    benchFormat();
+    benchReduce();
+}
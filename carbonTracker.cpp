@@ -1,42 +1,66 @@
 
+#include <cmath>
 #include <sstream>
 #include <unordered_map> 
 #include "carbonTracker.hpp"
+#include "fluxJournal.hpp"
+#include "adjointTape.hpp"
+#include "tracer.hpp"
+#include "trackerStats.hpp"
 #include "unitval.hpp"
 
 using namespace std;
 bool CarbonTracker::track = false;
+FluxJournal* CarbonTracker::journal = NULL;
+AdjointTape* CarbonTracker::tape = NULL;
+static ValidationStatus defaultStatus;
+ValidationStatus* CarbonTracker::status = &defaultStatus;
+unsigned CarbonTracker::trackedPoolMask = CarbonTracker::ALL_POOLS;
+unsigned CarbonTracker::trackedOriginMask = CarbonTracker::ALL_POOLS;
+int CarbonTracker::trackedOrigins[CarbonTracker::LAST] = {SOIL, ATMOSPHERE, DEEPOCEAN, TOPOCEAN};
+int CarbonTracker::nTrackedOrigins = CarbonTracker::LAST;
+int CarbonTracker::topK[CarbonTracker::LAST] = {LAST, LAST, LAST, LAST};
 string POOLNAMES[] = {"Soil", "Atmosphere", "Deep Ocean", "Top Ocean"};
+const double CarbonTracker::FRACTION_TOLERANCE = 1e-10;
 
+#ifndef CARBONTRACKER_NO_TRACKING
 CarbonTracker::CarbonTracker(Hector::unitval totC, Pool subPool){
-    H_ASSERT(subPool != CarbonTracker::LAST, "LAST is not a sub-pool of carbon, it is just a marker for the end of the enum")
-    H_ASSERT(totC.units() == Hector::U_PGC, "Wrong Units. Carbin tracker only accepts U_PGC");
+    // a LAST pool ends up all untracked, so carrying on is safe when validation is deferred
+    CT_VALID(subPool != CarbonTracker::LAST, BAD_POOL, "LAST is not a sub-pool of carbon, it is just a marker for the end of the enum");
+    if(!CT_VALID(totC.units() == Hector::U_PGC, WRONG_UNITS, "Wrong Units. Carbin tracker only accepts U_PGC")){
+        totC = Hector::unitval(double(totC), Hector::U_PGC);
+    }
 
     this->totalCarbon = totC;
-    for(int i = 0; i< LAST; ++i){
-        if(i == subPool){
-            this->originFracs[i] = 1;
-        }
-        else{
-            this->originFracs[i] = 0;
-        }
-    }
+    this->homePool = subPool;
+    this->journalRef = FluxJournal::NO_REF;
+    // carbon of an origin or in a pool that isn't tracked goes straight to the untracked bucket
+    initFracs(this->originFracs, this->untrackedFrac, subPool);
+    this->tapeNode = tape ? tape->recordLeaf(AdjointTape::INPUT, subPool, totC.value(Hector::U_PGC), this->originFracs)
+                          : AdjointTape::NO_NODE;
 }
+#endif
 
 // PRIVATE - ONLY FOR USE IN FLUX TO CARBON TRACKER FUNCTION
-CarbonTracker::CarbonTracker(Hector::unitval totC, double* poolFracs){
-    H_ASSERT(totC.units() == Hector::U_PGC, "Wrong Units. Carbin tracker only accepts U_PGC");
+CarbonTracker::CarbonTracker(Hector::unitval totC, double* poolFracs, Pool home, double untracked){
+    if(!CT_VALID(totC.units() == Hector::U_PGC, WRONG_UNITS, "Wrong Units. Carbin tracker only accepts U_PGC")){
+        totC = Hector::unitval(double(totC), Hector::U_PGC);
+    }
 
     this->totalCarbon = totC;
-    double counter = 0;
+    this->homePool = home;
+    this->journalRef = FluxJournal::NO_REF;
+    this->tapeNode = AdjointTape::NO_NODE;
+    this->untrackedFrac = untracked;
     for(int i = 0; i< LAST; ++i){
-        double frac = poolFracs[i];
-        this->originFracs[i] = frac;
+        this->originFracs[i] = poolFracs[i];
         //H_ASSERT(frac>=0, "Can't have negative proportion of a carbon pool");
-        counter += frac;
     }
     if(track){
-        H_ASSERT(counter == 1, "Pool fractions don't add up to 1.");
+        double drift = fracDrift(this->originFracs, untracked);
+        CT_STAT(noteDrift(drift));
+        CT_VALID(drift < FRACTION_TOLERANCE, FRACTION_DRIFT, "Pool fractions don't add up to 1.");
+        foldToTopK();
     }
 }
 
@@ -45,8 +69,14 @@ CarbonTracker::CarbonTracker(Hector::unitval totC, double* poolFracs){
 //     //delete totalCarbon; Does this not work bc unitval doesn't have a constructor? Do I need this?
 // }
 
+// Copying, the operators and the fluxes are inline in the header when tracking is compiled out
+#ifndef CARBONTRACKER_NO_TRACKING
 CarbonTracker::CarbonTracker(const CarbonTracker &ct){
     this->totalCarbon = ct.totalCarbon;
+    this->homePool = ct.homePool;
+    this->journalRef = ct.journalRef;
+    this->tapeNode = ct.tapeNode;
+    this->untrackedFrac = ct.untrackedFrac;
     for(int i = 0; i < CarbonTracker::Pool::LAST; ++i){
         this->originFracs[i] = ct.originFracs[i];
     }
@@ -54,6 +84,10 @@ CarbonTracker::CarbonTracker(const CarbonTracker &ct){
 
 CarbonTracker& CarbonTracker::operator=(CarbonTracker ct){
     this->totalCarbon = ct.totalCarbon;
+    this->homePool = ct.homePool;
+    this->journalRef = ct.journalRef;
+    this->tapeNode = ct.tapeNode;
+    this->untrackedFrac = ct.untrackedFrac;
     for(int i = 0; i < CarbonTracker::Pool::LAST; ++i){
         this->originFracs[i] = ct.originFracs[i];
     }
@@ -62,27 +96,31 @@ CarbonTracker& CarbonTracker::operator=(CarbonTracker ct){
 
 
 CarbonTracker CarbonTracker::operator+(const CarbonTracker& flux){
+    CT_TRACE_SPAN("CarbonTracker::operator+", "tracker");
+    CT_STAT(countOp(TrackerStats::ADD));
+    if(!CT_VALID(flux.totalCarbon.units() == this->totalCarbon.units(), WRONG_UNITS, "Only carbon can be used in carbon tracker!")){
+        return *this;
+    }
     Hector::unitval totC = this->totalCarbon + flux.totalCarbon;
+    CT_STAT(countMoved(flux.homePool, this->homePool, double(flux.totalCarbon)));
     double newOrigins[CarbonTracker::LAST];
-    if(!track){
-        double fluxAddedPoolCheck = 0; 
-        for(int i = 0; i < CarbonTracker::LAST; ++i){
-            newOrigins[i] = (totC * this->originFracs[i] + 
-                        totC * flux.originFracs[i]) / totC;
-            fluxAddedPoolCheck += (this->originFracs[i] + flux.originFracs[i]);
-        }
-        // fluxToTrackerPool makes the originFracs of a pool all 0 if it is not tracking so that it won't mess up
-        // the fractions of the pool the flux is added to - since tracking is off pool should only have 1 non-zero
-        // array element from the public constructor
-        H_ASSERT(fluxAddedPoolCheck == 1, "You can only add a flux to a pool, not a pool to a pool!")
+    double newUntracked;
+    // fluxToTrackerPool makes the originFracs of a pool all 0 if it is not tracking so that it won't mess up
+    // the fractions of the pool the flux is added to - since tracking is off pool should only have 1 non-zero
+    // array element from the public constructor
+    CT_VALID(addFracs(newOrigins, newUntracked, this->originFracs, this->untrackedFrac, this->totalCarbon.value(Hector::U_PGC), 
+                      this->homePool, flux.originFracs, flux.untrackedFrac, flux.totalCarbon.value(Hector::U_PGC), totC.value(Hector::U_PGC)),
+             BAD_POOL, "You can only add a flux to a pool, not a pool to a pool!");
+    if(track && tracksPool(this->homePool)){
+        CT_STAT(countRenormalization());
     }
-    else{
-        for(int i = 0; i < CarbonTracker::LAST; ++i){
-            newOrigins[i] = (this->totalCarbon * this->originFracs[i] + 
-                        flux.totalCarbon * flux.originFracs[i]) / totC;
-        }
+    if(journal){
+        journal->record(FluxJournal::ADD, flux.homePool, this->homePool, flux.totalCarbon.value(Hector::U_PGC), flux.journalRef);
+    }
+    CarbonTracker addedFlux(totC, newOrigins, this->homePool, newUntracked);
+    if(tape){
+        addedFlux.tapeNode = tape->record(this->tapeNode, 1, flux.tapeNode, 1);
     }
-    CarbonTracker addedFlux(totC, newOrigins);
     return addedFlux;
 }
 
@@ -90,18 +128,29 @@ CarbonTracker CarbonTracker::operator+(const CarbonTracker& flux){
 // This will be usful for isotopes but not for general use
 // Order matters - flux object's carbon removed from pool object's carbon
 CarbonTracker CarbonTracker::operator-(const CarbonTracker& flux){
-    Hector::unitval totC = this->totalCarbon - flux.totalCarbon;
-    if(!CarbonTracker::track){
+    CT_TRACE_SPAN("CarbonTracker::operator-", "tracker");
+    if(!CarbonTracker::track || !tracksPool(this->homePool)){
         return *this - flux.totalCarbon; // calls below operator- method that takes unitvals
     }
+    else if(!CT_VALID(flux.totalCarbon.units() == Hector::U_PGC, WRONG_UNITS, "Only carbon can be used in carbon tracker!")){
+        return *this;
+    }
     else{
+        CT_STAT(countOp(TrackerStats::SUBTRACT));
+        CT_STAT(countRenormalization());
+        Hector::unitval totC = this->totalCarbon - flux.totalCarbon;
+        CT_DEFERRED_CHECK(totC >= 0, NEGATIVE_CARBON, "Pool doesn't have enough carbon to subtract the whole flux - no negative carbon allowed");
+        if(journal){
+            journal->record(FluxJournal::SUBTRACT, this->homePool, flux.homePool, flux.totalCarbon.value(Hector::U_PGC), flux.journalRef);
+        }
         double newOrigins[CarbonTracker::LAST];
-        for(int i = 0; i < CarbonTracker::LAST; ++i){
-            Hector::unitval poolCarbon = this->totalCarbon * this->originFracs[i] - flux.totalCarbon * flux.originFracs[i];
-            //H_ASSERT(poolCarbon >= 0, "Pool doesn't have enough carbon to subtract the whole flux - no negative carbon allowed");
-            newOrigins[i] = poolCarbon / totC;
+        double newUntracked;
+        mixPool(newOrigins, newUntracked, this->originFracs, this->untrackedFrac, this->totalCarbon.value(Hector::U_PGC),
+                flux.originFracs, flux.untrackedFrac, -flux.totalCarbon.value(Hector::U_PGC), totC.value(Hector::U_PGC));
+        CarbonTracker subtractFlux(totC, newOrigins, this->homePool, newUntracked);
+        if(tape){
+            subtractFlux.tapeNode = tape->record(this->tapeNode, 1, flux.tapeNode, -1);
         }
-        CarbonTracker subtractFlux(totC, newOrigins);
         return subtractFlux;
     }
     
@@ -110,36 +159,66 @@ CarbonTracker CarbonTracker::operator-(const CarbonTracker& flux){
 // Removes carbon from each of the subpools equally by proportion
 // Order matters - will keep 'pools' array when a flux is subtracted from a pool
  CarbonTracker CarbonTracker::operator-(const Hector::unitval flux){
-    H_ASSERT(flux.units() == Hector::U_PGC, "Only carbon can be used in carbon tracker!")
-    //H_ASSERT(this->totalCarbon > flux, "You cannot remove that much carbon, flux is larger than total carbon");
-    CarbonTracker ct(this->totalCarbon - flux, this->originFracs);
+    CT_TRACE_SPAN("CarbonTracker::operator-(unitval)", "tracker");
+    CT_STAT(countOp(TrackerStats::SUBTRACT));
+    if(!CT_VALID(flux.units() == Hector::U_PGC, WRONG_UNITS, "Only carbon can be used in carbon tracker!")){
+        return *this;
+    }
+    CT_DEFERRED_CHECK(this->totalCarbon >= flux, NEGATIVE_CARBON, "You cannot remove that much carbon, flux is larger than total carbon");
+    if(journal){
+        journal->record(FluxJournal::SUBTRACT, this->homePool, CarbonTracker::LAST, flux.value(Hector::U_PGC), FluxJournal::NO_REF);
+    }
+    CarbonTracker ct(this->totalCarbon - flux, this->originFracs, this->homePool, this->untrackedFrac);
+    if(tape){
+        // the removed carbon is a constant here, so only the pool carries sensitivity through
+        ct.tapeNode = tape->record(this->tapeNode, 1, AdjointTape::NO_NODE, 0);
+    }
     return ct;
  }
 
 // order matters - see below operator* for other order
  CarbonTracker operator*(const double d, CarbonTracker& ct){
+    CT_STAT(countOp(TrackerStats::MULTIPLY));
     CarbonTracker multipliedCT(ct);
     multipliedCT.setTotalCarbon(multipliedCT.getTotalCarbon() * d);
+    if(CarbonTracker::tape){
+        multipliedCT.tapeNode = CarbonTracker::tape->record(ct.tapeNode, d, AdjointTape::NO_NODE, 0);
+    }
     return multipliedCT;
  }
 
  CarbonTracker operator*(const CarbonTracker& ct, const double d){
+    CT_STAT(countOp(TrackerStats::MULTIPLY));
     CarbonTracker multipliedCT(ct);
     multipliedCT.setTotalCarbon(multipliedCT.getTotalCarbon() * d);
+    if(CarbonTracker::tape){
+        multipliedCT.tapeNode = CarbonTracker::tape->record(ct.tapeNode, d, AdjointTape::NO_NODE, 0);
+    }
     return multipliedCT;
  }
 
  CarbonTracker operator/(CarbonTracker& ct, const double d){
-    H_ASSERT(d != 0, "No dividing by 0!");
+    CT_STAT(countOp(TrackerStats::DIVIDE));
+    if(!CT_VALID(d != 0, DIVIDE_BY_ZERO, "No dividing by 0!")){
+        return ct;
+    }
     CarbonTracker dividedCT(ct);
     dividedCT.setTotalCarbon(dividedCT.getTotalCarbon() / d);
+    if(CarbonTracker::tape){
+        dividedCT.tapeNode = CarbonTracker::tape->record(ct.tapeNode, 1 / d, AdjointTape::NO_NODE, 0);
+    }
     return dividedCT;
  }
+#endif
 
  void CarbonTracker::setTotalCarbon(Hector::unitval tCarbon){
-    H_ASSERT(tCarbon.units() == Hector::U_PGC, "Carbon Tracker only accepts unitvals with units U_PGC");
+    if(!CT_VALID(tCarbon.units() == Hector::U_PGC, WRONG_UNITS, "Carbon Tracker only accepts unitvals with units U_PGC")){
+        return;
+    }
     //H_ASSERT(tCarbon >=0, "Cannot set total carbon to a negative number!");
     this->totalCarbon = tCarbon;
+    // a value set from outside has no recorded history
+    this->tapeNode = AdjointTape::NO_NODE;
  }
 
 //  void CarbonTracker::setOriginFracs(double* poolFracs){
@@ -148,19 +227,61 @@ CarbonTracker CarbonTracker::operator-(const CarbonTracker& flux){
 //     }
 //  }
 
+#ifndef CARBONTRACKER_NO_TRACKING
  Hector::unitval CarbonTracker::getTotalCarbon(){
      return this->totalCarbon;
  }
+#endif
 
  double* CarbonTracker::getOriginFracs(){
      return this->originFracs;
  }
 
+ CarbonTracker::Pool CarbonTracker::getHomePool(){
+     return this->homePool;
+ }
+
 Hector::unitval CarbonTracker::getPoolCarbon(Pool subPool){
     H_ASSERT(subPool != CarbonTracker::LAST, "LAST is not a sub-pool of carbon, it is just a marker for the end of the enum");
     return this->originFracs[subPool] * this-> totalCarbon;
 }
 
+double CarbonTracker::getUntrackedFrac(){
+    return this->untrackedFrac;
+}
+
+Hector::unitval CarbonTracker::getUntrackedCarbon(){
+    return this->untrackedFrac * this->totalCarbon;
+}
+
+void CarbonTracker::setTrackingMask(unsigned pools, unsigned origins){
+    H_ASSERT((pools & ~ALL_POOLS) == 0 && (origins & ~ALL_POOLS) == 0, "Tracking mask has bits past the last pool");
+    trackedPoolMask = pools;
+    trackedOriginMask = origins;
+    nTrackedOrigins = 0;
+    for(int i = 0; i < LAST; ++i){
+        if(tracksOrigin((Pool)i)){
+            trackedOrigins[nTrackedOrigins++] = i;
+        }
+    }
+}
+
+void CarbonTracker::setTopK(Pool p, int k){
+    H_ASSERT(p != LAST, "LAST is not a sub-pool of carbon, it is just a marker for the end of the enum");
+    H_ASSERT(k >= 0, "Can't keep a negative number of origins");
+    topK[p] = k < LAST ? k : LAST;
+}
+
+int CarbonTracker::getTopK(Pool p){
+    H_ASSERT(p != LAST, "LAST is not a sub-pool of carbon, it is just a marker for the end of the enum");
+    return topK[p];
+}
+
+Hector::unitval CarbonTracker::getAttributionErrorBound(){
+    return getUntrackedCarbon();
+}
+
+#ifndef CARBONTRACKER_NO_TRACKING
 bool CarbonTracker::isTracking(){
       return CarbonTracker::track;
 }
@@ -168,22 +289,67 @@ bool CarbonTracker::isTracking(){
 void CarbonTracker::startTracking(){
         CarbonTracker::track = true;
 }
+#else
+void CarbonTracker::startTracking(){
+        H_THROW("Tracking was compiled out (CARBONTRACKER_NO_TRACKING)");
+}
+#endif
+
+void CarbonTracker::checkFailed(const char* msg){
+        H_THROW("Assertion failed: " + string(msg));
+}
 
 void CarbonTracker::stopTracking(){
         CarbonTracker::track = false;
 }
 
+void CarbonTracker::attachJournal(FluxJournal* j){
+        CarbonTracker::journal = j;
+}
+
+FluxJournal* CarbonTracker::getJournal(){
+        return CarbonTracker::journal;
+}
+
+void CarbonTracker::attachTape(AdjointTape* t){
+        // fluxes made without tracking carry no fractions, so every sensitivity would silently come out 0
+        H_ASSERT(t == NULL || CarbonTracker::track, "Adjoint tape needs tracking - call startTracking first");
+        CarbonTracker::tape = t;
+}
+
+AdjointTape* CarbonTracker::getTape(){
+        return CarbonTracker::tape;
+}
+
+void CarbonTracker::attachStatus(ValidationStatus* s){
+        CarbonTracker::status = s ? s : &defaultStatus;
+}
+
+#ifndef CARBONTRACKER_NO_TRACKING
 CarbonTracker CarbonTracker::fluxFromTrackerPool(const Hector::unitval flux){
+    CT_TRACE_SPAN("CarbonTracker::fluxFromTrackerPool", "tracker");
+    CT_STAT(countOp(TrackerStats::FLUX));
     // DOES THIS MAKE IT SEEM LIKE IT WILL SUBTRACT FOR YOU? BECAUSE IT DOESN'T
-    H_ASSERT(flux.units() == Hector::U_PGC, "Flux must be in units U_PGC for carbon tracker");
     //H_ASSERT(this->totalCarbon >= flux, "You don't have enough carbon in the pool to make a flux of that size");
     CarbonTracker ct(*this);
-    ct.setTotalCarbon(flux);
+    if(CT_VALID(flux.units() == Hector::U_PGC, WRONG_UNITS, "Flux must be in units U_PGC for carbon tracker")){
+        ct.setTotalCarbon(flux);
+    }
+    else{
+        ct.setTotalCarbon(Hector::unitval(double(flux), Hector::U_PGC));
+    }
     if(!track){
         for(int i = 0; i<CarbonTracker::LAST; ++i){
             ct.originFracs[i] = 0;
             // if not tracking then the array is all 0s because the flux should not change original arrays
         }
+        ct.untrackedFrac = 0;
+    }
+    if(journal){
+        ct.journalRef = journal->record(FluxJournal::FLUX, this->homePool, CarbonTracker::LAST, double(flux), FluxJournal::NO_REF);
+    }
+    if(tape){
+        ct.tapeNode = tape->recordLeaf(AdjointTape::FLUX, this->homePool, double(flux), ct.originFracs);
     }
     return ct;
 }
@@ -192,12 +358,15 @@ CarbonTracker CarbonTracker::fluxFromTrackerPool(const Hector::unitval flux){
 // USEFUL FOR WHEN YOU WANT TO MAKE A CUSTOM FLUX WITH DIFFERENT POOLS OF CARBON BEING PULLED FROM MORE THAN OTHERS
 // This will be usful for isotopes but not for general use
 CarbonTracker CarbonTracker::fluxFromTrackerPool(const Hector::unitval fluxAmount, double* fluxProportions){
+    CT_TRACE_SPAN("CarbonTracker::fluxFromTrackerPool(proportions)", "tracker");
+    CT_STAT(countOp(TrackerStats::FLUX));
     // DOES THIS MAKE IT SEEM LIKE IT WILL SUBTRACT FOR YOU? BECAUSE IT DOESN'T
-    H_ASSERT(fluxAmount.units() == Hector::U_PGC, "Flux must be in units U_PGC for carbon tracker");
+    CT_VALID(fluxAmount.units() == Hector::U_PGC, WRONG_UNITS, "Flux must be in units U_PGC for carbon tracker");
     // SHOULD PEOPLE BE ABLE TO CREATE FREE FLOATING FLUXES THAT ARE BIGGER THAN WERE THEY MIGHT TAKE THEM FROM??
     // ARE THERE FLUXES W/OUT ARRAYS (I.E. JUST UNITVALS) THAT ARE INTERJECTED?
     //H_ASSERT(this->totalCarbon >= fluxAmount, "You don't have enough carbon in the pool to make a flux of that size");
     double fluxFracs[CarbonTracker::LAST];
+    double untracked = 0;
     if(!track){
         for(int i = 0; i<CarbonTracker::LAST; ++i){
             fluxFracs[i] = 0;
@@ -205,16 +374,151 @@ CarbonTracker CarbonTracker::fluxFromTrackerPool(const Hector::unitval fluxAmoun
         }
     }
     else{
+        // proportions given for origins that aren't tracked land in the untracked bucket - checked before the
+        // split, since the untracked bucket would otherwise make up any shortfall
+        untracked = 1;
+        double counter = 0;
         for(int i = 0; i<CarbonTracker::LAST; ++i){
-            fluxFracs[i] = fluxProportions[i];
+            fluxFracs[i] = tracksOrigin((Pool)i) ? fluxProportions[i] : 0;
+            untracked -= fluxFracs[i];
+            counter += fluxProportions[i];
+        }
+        CT_VALID(fabs(counter - 1) < FRACTION_TOLERANCE, FRACTION_DRIFT, "Pool fractions don't add up to 1.");
+    }
+    CarbonTracker ct(fluxAmount, fluxFracs, this->homePool, untracked);
+    if(journal){
+        // custom proportions are expressed over the tracked origins, so the replay treats this flux as proportional
+        ct.journalRef = journal->record(FluxJournal::FLUX, this->homePool, CarbonTracker::LAST, double(fluxAmount), FluxJournal::NO_REF);
+    }
+    if(tape){
+        ct.tapeNode = tape->recordLeaf(AdjointTape::FLUX, this->homePool, double(fluxAmount), ct.originFracs);
+    }
+    return ct;
+}
+#endif
+
+#ifndef CARBONTRACKER_NO_TRACKING
+void CarbonTracker::transferWithFracs(CarbonTracker& src, CarbonTracker& dst, const Hector::unitval& amount,
+                                      const double* fracs, double untracked){
+    CT_TRACE_SPAN("CarbonTracker::transfer", "tracker");
+    if(!CT_VALID(amount.units() == Hector::U_PGC, WRONG_UNITS, "Flux must be in units U_PGC for carbon tracker") ||
+       !CT_VALID(&src != &dst, BAD_POOL, "Can't transfer carbon from a pool to itself")){
+        return;
+    }
+    double moved = amount.value(Hector::U_PGC);
+    double srcC = src.totalCarbon.value(Hector::U_PGC);
+    double dstC = dst.totalCarbon.value(Hector::U_PGC);
+    Hector::unitval newSrc = src.totalCarbon - amount;
+    Hector::unitval newDst = dst.totalCarbon + amount;
+    CT_DEFERRED_CHECK(newSrc >= 0, NEGATIVE_CARBON, "You cannot remove that much carbon, flux is larger than total carbon");
+    CT_STAT(countOp(TrackerStats::TRANSFER));
+    CT_STAT(countMoved(src.homePool, dst.homePool, moved));
+
+    if(journal){
+        uint32_t ref = journal->record(FluxJournal::FLUX, src.homePool, CarbonTracker::LAST, moved, FluxJournal::NO_REF);
+        journal->record(FluxJournal::SUBTRACT, src.homePool, src.homePool, moved, ref);
+        journal->record(FluxJournal::ADD, src.homePool, dst.homePool, moved, ref);
+    }
+    if(tape){
+        // a flux made while not tracking carries no fractions
+        static const double noFracs[CarbonTracker::LAST] = {0};
+        uint32_t fluxNode = tape->recordLeaf(AdjointTape::FLUX, src.homePool, moved, track ? fracs : noFracs);
+        src.tapeNode = tape->record(src.tapeNode, 1, fluxNode, -1);
+        dst.tapeNode = tape->record(dst.tapeNode, 1, fluxNode, 1);
+    }
+
+    // when not tracking, or between untracked pools, fractions don't change - only the totals move
+    if(track){
+        bool srcMixes = fracs != src.originFracs && tracksPool(src.homePool);
+        bool dstMixes = tracksPool(dst.homePool);
+        double srcNewC = newSrc.value(Hector::U_PGC);
+        double dstNewC = newDst.value(Hector::U_PGC);
+        // one pass over the tracked origins updates both pools - untracked origins are 0 everywhere
+        for(int k = 0; k < nTrackedOrigins; ++k){
+            int i = trackedOrigins[k];
+            double f = fracs[i];
+            if(srcMixes){
+                src.originFracs[i] = (srcC * src.originFracs[i] - moved * f) / srcNewC;
+            }
+            if(dstMixes){
+                dst.originFracs[i] = (dstC * dst.originFracs[i] + moved * f) / dstNewC;
+            }
+        }
+        if(srcMixes){
+            src.untrackedFrac = (srcC * src.untrackedFrac - moved * untracked) / srcNewC;
+            src.foldToTopK();
+            CT_STAT(countRenormalization());
         }
+        if(dstMixes){
+            dst.untrackedFrac = (dstC * dst.untrackedFrac + moved * untracked) / dstNewC;
+            dst.foldToTopK();
+            CT_STAT(countRenormalization());
+        }
+    }
+    // the same amount leaves src and enters dst, so their total carbon is conserved
+    src.totalCarbon = newSrc;
+    dst.totalCarbon = newDst;
+}
+
+void CarbonTracker::transfer(CarbonTracker& src, CarbonTracker& dst, const Hector::unitval amount){
+    transferWithFracs(src, dst, amount, src.originFracs, src.untrackedFrac);
+}
+
+void CarbonTracker::transfer(CarbonTracker& src, CarbonTracker& dst, const Hector::unitval amount, double* fluxProportions){
+    // proportions given for origins that aren't tracked land in the untracked bucket
+    double fluxFracs[CarbonTracker::LAST];
+    double untracked = 1;
+    double counter = 0;
+    for(int i = 0; i < CarbonTracker::LAST; ++i){
+        fluxFracs[i] = tracksOrigin((Pool)i) ? fluxProportions[i] : 0;
+        untracked -= fluxFracs[i];
+        counter += fluxProportions[i];
     }
-    return CarbonTracker(fluxAmount, fluxFracs);
+    if(track){
+        CT_VALID(fabs(counter - 1) < FRACTION_TOLERANCE, FRACTION_DRIFT, "Pool fractions don't add up to 1.");
+    }
+    transferWithFracs(src, dst, amount, fluxFracs, untracked);
+}
+#endif
+
+void CarbonTracker::exchange(CarbonTracker& a, CarbonTracker& b, double kab, double kba, double dt){
+    // a negative rate or step would move negative carbon - skipped (and flagged) when validation is deferred
+    if(!CT_VALID(kab >= 0 && kba >= 0 && dt >= 0, NEGATIVE_CARBON, "Exchange rates and step can't be negative")){
+        return;
+    }
+    double k = kab + kba;
+    if(k == 0 || dt == 0){
+        return;
+    }
+    // each pool relaxes to its equilibrium share by 1 - exp(-k dt) - expm1 keeps small steps accurate
+    double relaxed = -expm1(-k * dt);
+    Hector::unitval ab(a.totalCarbon.value(Hector::U_PGC) * (kab / k) * relaxed, Hector::U_PGC);
+    Hector::unitval ba(b.totalCarbon.value(Hector::U_PGC) * (kba / k) * relaxed, Hector::U_PGC);
+#ifndef CARBONTRACKER_NO_TRACKING
+    CT_TRACE_SPAN("CarbonTracker::exchange", "tracker");
+    // both gross flows carry the fractions from the start of the step
+    double aFracs[LAST];
+    double bFracs[LAST];
+    for(int i = 0; i < LAST; ++i){
+        aFracs[i] = a.originFracs[i];
+        bFracs[i] = b.originFracs[i];
+    }
+    double aUntracked = a.untrackedFrac;
+    double bUntracked = b.untrackedFrac;
+    transferWithFracs(a, b, ab, aFracs, aUntracked);
+    transferWithFracs(b, a, ba, bFracs, bUntracked);
+#else
+    transfer(a, b, ab);
+    transfer(b, a, ba);
+#endif
 }
 
 ostream& operator<<(ostream &out, CarbonTracker &ct ){
     for(int i = 0; i<CarbonTracker::LAST; ++i){
         out << POOLNAMES[i]<<": "<< ct.getPoolCarbon((CarbonTracker::Pool)i)<<" "<<endl;
     }
+    if(ct.untrackedFrac != 0){
+        out << "untracked: "<< ct.getUntrackedCarbon()<<" "<<endl;
+    }
     return out;
 }
\ No newline at end of file
@@ -1,11 +1,54 @@
 #ifndef CARBONTRACKER_HPP
 #define CARBONTRACKER_HPP
+#include <cmath>
 #include <sstream>
 #include <unordered_map> 
+#include <stdint.h>
 #include "unitval.hpp"
+#include "validationStatus.hpp"
 
 using namespace std;
 
+// Build with CARBONTRACKER_NO_TRACKING to compile origin tracking out entirely: the copy, operators and fluxes
+// below become inline total carbon updates (one unitval add or subtract) with no fraction loops, no journal or
+// tape hooks and isTracking() a constant false. startTracking() then throws.
+
+// Build with CARBONTRACKER_DEFERRED_VALIDATION and the checks on the hot paths (units, negative carbon, fraction
+// drift, division by 0) stop throwing: a failure is flagged in CarbonTracker::getStatus() and the operation
+// goes on (or is skipped when it can't) - call getStatus().check() once per timestep to raise them.
+// CT_VALID is true if x holds - otherwise it throws like H_ASSERT, or flags f and is false when deferred.
+// CT_DEFERRED_CHECK flags checks that only exist in deferred mode (they were never asserted).
+// Failures are counted with CT_STAT, so these are only used where trackerStats.hpp is included.
+#ifdef CARBONTRACKER_DEFERRED_VALIDATION
+#define CT_VALID(x, f, s) ((x) || (CT_STAT(countCheckFailure(ValidationStatus::f)), \
+                                   CarbonTracker::getStatus().flag(ValidationStatus::f, s, __func__, __FILE__, __LINE__)))
+#define CT_DEFERRED_CHECK(x, f, s) ((void)CT_VALID(x, f, s))
+#else
+#define CT_VALID(x, f, s) ((x) || (CT_STAT(countCheckFailure(ValidationStatus::f)), \
+                                   throw h_exception("Assertion failed: " + std::string(s), __func__, __FILE__, __LINE__), false))
+#define CT_DEFERRED_CHECK(x, f, s) ((void)0)
+#endif
+
+class FluxJournal;
+class AdjointTape;
+template<class V> class BasicCarbonTracker;
+
+// Lanes of a fraction for the tracking rules, which run on double here and on the lane types of
+// BasicCarbonTracker (overloads next to Hector::dual and Hector::batch): how many lanes pick their own origins
+// to fold, the value a lane is judged by and moving one lane of a fraction into another
+inline int foldLanes(double){
+    return 1;
+}
+
+inline double laneValue(double f, int){
+    return f;
+}
+
+inline void moveLane(double& to, double& from, int){
+    to += from;
+    from = 0;
+}
+
   /**
    * \brief CarbonTracker Class: class to track origin of carbon in various carbon pools as it moves throughout the carbon cycle
    * in simple climate model Hector
@@ -22,6 +65,9 @@ using namespace std;
       SOIL, ATMOSPHERE, DEEPOCEAN, TOPOCEAN, LAST
     };
 
+    // tracking mask with every pool (or origin) set - bit i is (1u << Pool i)
+    static const unsigned ALL_POOLS = (1u << LAST) - 1;
+
 
 
    private:
@@ -33,17 +79,209 @@ using namespace std;
     // indicies correspond to indices of array within 
     double originFracs[LAST];
 
+    // pool this object belongs to (or, for a flux, the pool it was taken from) - LAST if unknown
+    Pool homePool;
+
+    // index of the journal record that created this flux - FluxJournal::NO_REF for pools
+    uint32_t journalRef;
+
+    // node on the adjoint tape holding this value - AdjointTape::NO_NODE if not recorded
+    uint32_t tapeNode;
+
+    // fraction of the carbon from origins that aren't tracked, or held in a pool that isn't tracked
+    double untrackedFrac;
+
     // boolean to signify if tracker should be tracking carbon movement
     static bool track;
 
+    // journal that transfers are recorded to - null when not journaling
+    static FluxJournal* journal;
+
+    // tape that mixing steps are recorded to for adjoint attribution - null when not recording
+    static AdjointTape* tape;
+
+    // where deferred validation failures are flagged - never null
+    static ValidationStatus* status;
+
+    // bitmasks of the pools that keep origin fractions and of the origins that get their own fraction
+    static unsigned trackedPoolMask;
+    static unsigned trackedOriginMask;
+
+    // tracked origins as a dense index list so mixing skips the ones that are always 0
+    static int trackedOrigins[LAST];
+    static int nTrackedOrigins;
+
+    // most origins each pool keeps explicitly - the rest are folded into the untracked bucket (LAST for exact)
+    static int topK[LAST];
+
+    // how far the sum of the origin fractions may drift from 1 through rounding
+    static const double FRACTION_TOLERANCE;
+
+    // The tracking rules below are shared with BasicCarbonTracker, so both attribute the same way for any lane
+    // type T - double here
+
+    /**
+      *\brief fractions of a new pool whose carbon all comes from subPool - in the untracked bucket if the mask
+              leaves it out
+      */
+    template<class T>
+    static void initFracs(T* fracs, T& untracked, Pool subPool){
+        bool tracked = tracksPool(subPool) && tracksOrigin(subPool);
+        untracked = T(tracked ? 0.0 : 1.0);
+        for(int i = 0; i < LAST; ++i){
+            fracs[i] = T(i == subPool && tracked ? 1.0 : 0.0);
+        }
+        foldToTopK(fracs, untracked, subPool);
+    }
+
+    /**
+      *\brief folds the smallest origin fractions into the untracked bucket until at most topK[home] are left -
+              lanes that pick their own origins (ensemble members) are folded one at a time
+      */
+    template<class T>
+    static void foldToTopK(T* fracs, T& untracked, Pool home){
+        if(home == LAST || topK[home] >= nTrackedOrigins){
+            return;
+        }
+        for(int lane = 0; lane < foldLanes(untracked); ++lane){
+            int kept = 0;
+            for(int i = 0; i < LAST; ++i){
+                kept += laneValue(fracs[i], lane) != 0;
+            }
+            // LAST is small so repeatedly dropping the smallest is cheaper than sorting
+            for(; kept > topK[home]; --kept){
+                int smallest = -1;
+                for(int i = 0; i < LAST; ++i){
+                    if(laneValue(fracs[i], lane) != 0 && 
+                       (smallest < 0 || fabs(laneValue(fracs[i], lane)) < fabs(laneValue(fracs[smallest], lane)))){
+                        smallest = i;
+                    }
+                }
+                moveLane(untracked, fracs[smallest], lane);
+            }
+        }
+    }
+
+    /**
+      *\brief folds this pool's smallest origin fractions into its untracked bucket until at most topK[homePool]
+              are left
+      */
+    void foldToTopK(){
+        foldToTopK(originFracs, untrackedFrac, homePool);
+    }
+
+    /**
+      *\brief mixing kernel - out = (aC * a + bC * b) / newC for every tracked origin, other entries are left
+              alone. out may be a or b
+      */
+    template<class T>
+    static void mixFracs(T* out, const T* a, const T& aC, const T* b, const T& bC, const T& newC){
+        for(int k = 0; k < nTrackedOrigins; ++k){
+            int i = trackedOrigins[k];
+            out[i] = (aC * a[i] + bC * b[i]) / newC;
+        }
+    }
+
+    /**
+      *\brief fractions and untracked fraction of aC carbon with fractions a mixed with bC carbon with fractions b
+              (bC negative to take it out) - untracked origins stay 0
+      */
+    template<class T>
+    static void mixPool(T* out, T& outUntracked, const T* a, const T& aUntracked, const T& aC,
+                        const T* b, const T& bUntracked, const T& bC, const T& newC){
+        for(int i = 0; i < LAST; ++i){
+            out[i] = T(0.0);
+        }
+        mixFracs(out, a, aC, b, bC, newC);
+        outUntracked = (aC * aUntracked + bC * bUntracked) / newC;
+    }
+
+    /**
+      *\brief fractions of pool a plus flux b by the tracking rules - without tracking the flux's fractions are all 0
+              and the sums stay the pool's, an untracked pool keeps its fractions, otherwise the two are mixed
+      *\return false if the sums don't add up to 1 without tracking - a pool was added to a pool
+      */
+    template<class T>
+    static bool addFracs(T* out, T& outUntracked, const T* a, const T& aUntracked, const T& aC, Pool home,
+                         const T* b, const T& bUntracked, const T& bC, const T& newC){
+        if(!track){
+            // fractions are all 0 or 1 here, so this is the same as mixing by newC without the work
+            outUntracked = aUntracked + bUntracked;
+            T check = outUntracked;
+            for(int i = 0; i < LAST; ++i){
+                out[i] = a[i] + b[i];
+                check = check + out[i];
+            }
+            for(int lane = 0; lane < foldLanes(check); ++lane){
+                if(laneValue(check, lane) != 1){
+                    return false;
+                }
+            }
+        }
+        else if(!tracksPool(home)){
+            // untracked pools only ever hold untracked carbon, so just the total changes
+            for(int i = 0; i < LAST; ++i){
+                out[i] = a[i];
+            }
+            outUntracked = aUntracked;
+        }
+        else{
+            mixPool(out, outUntracked, a, aUntracked, aC, b, bUntracked, bC, newC);
+        }
+        return true;
+    }
+
+    /**
+      *\brief how far the fractions and the untracked fraction sum from 1, the largest over the lanes
+      */
+    template<class T>
+    static double fracDrift(const T* fracs, const T& untracked){
+        T counter = untracked;
+        for(int i = 0; i < LAST; ++i){
+            counter = counter + fracs[i];
+        }
+        double drift = 0;
+        for(int lane = 0; lane < foldLanes(counter); ++lane){
+            drift = fmax(drift, fabs(laneValue(counter, lane) - 1));
+        }
+        return drift;
+    }
+
+    /**
+      *\brief the in place update shared by both transfer overloads - fracs and untracked describe the moved carbon,
+              and src keeps its fractions when fracs is src's own array
+      */
+    static void transferWithFracs(CarbonTracker& src, CarbonTracker& dst, const Hector::unitval& amount,
+                                  const double* fracs, double untracked);
+
+    friend class AdjointTape;
+    template<class V> friend class BasicCarbonTracker;
+    friend class FluxReduction;
+    friend class FluxAccumulator;
+
     /**
       *\brief parameterized constructor - useful for initializing fluxes with predetermined maps -
               ONLY FOR USE WITHIN CPP NOT FOR GENERAL USE TO AVOID INITIALIZATION ISSUES
       *\param totalCarbon unitval (units pg C) that expresses total amount of carbon in the pool
       *\param origin_frax pointer to a double array - usually the originFracs array of the pool the flux is leaving
+      *\param home pool the new object belongs to (LAST if unknown)
+      *\param untracked fraction of the carbon in the untracked bucket
       * \return CarbonTracker object with totalCarbon set and an array set equal to the pointer object
       */
-    CarbonTracker(Hector::unitval totC, double* pool_map);
+    CarbonTracker(Hector::unitval totC, double* pool_map, Pool home = LAST, double untracked = 0);
+
+    /**
+      *\brief copy of this object with a different total carbon and no checks or hooks - only defined
+              when tracking is compiled out (CARBONTRACKER_NO_TRACKING)
+      */
+    CarbonTracker withTotalCarbon(const Hector::unitval& totC) const;
+
+    /**
+      *\brief throws a failed assertion - kept out of line so the inline operators stay small enough to
+              inline
+      *\param msg what was asserted
+      */
+    [[noreturn]] static void checkFailed(const char* msg);
 
    public:
 
@@ -126,6 +364,12 @@ using namespace std;
       */ 
     double* getOriginFracs();
 
+    /**
+      * \brief getter for the pool this object belongs to - for a flux, the pool it was taken from
+      * \return Pool the object was created for (LAST if unknown)
+      */ 
+    Pool getHomePool();
+
     /**
       * \brief getter for indiviudal key-value pairs within a CarbonTracker map object
       * \param MultiKey object
@@ -133,6 +377,67 @@ using namespace std;
       */ 
     Hector::unitval getPoolCarbon(Pool origin);
 
+    /**
+      * \brief getter for the fraction of carbon that isn't attributed to a tracked origin
+      * \return fraction of total carbon in the untracked bucket
+      */ 
+    double getUntrackedFrac();
+
+    /**
+      * \brief getter for the carbon that isn't attributed to a tracked origin
+      * \return unitval with units (pg C)
+      */ 
+    Hector::unitval getUntrackedCarbon();
+
+    /**
+      * \brief chooses which pools keep origin fractions and which origins get their own fraction - carbon from
+      *        any other origin, and everything held in an untracked pool, is lumped into the untracked bucket.
+      *        Set before creating the pools; existing objects are not re-attributed
+      * \param pools bitmask of tracked pools (bit 1u << Pool), ALL_POOLS by default
+      * \param origins bitmask of tracked origins (bit 1u << Pool), ALL_POOLS by default
+      */ 
+    static void setTrackingMask(unsigned pools, unsigned origins);
+
+    /**
+      * \brief whether a pool keeps origin fractions under the current mask - LAST (unknown) counts as tracked
+      * \param p pool to check
+      * \return true if p is tracked
+      */ 
+    static bool tracksPool(Pool p){
+        return p == LAST || (trackedPoolMask >> p) & 1u;
+    }
+
+    /**
+      * \brief whether an origin gets its own fraction under the current mask
+      * \param p origin to check
+      * \return true if p is tracked
+      */ 
+    static bool tracksOrigin(Pool p){
+        return (trackedOriginMask >> p) & 1u;
+    }
+
+    /**
+      * \brief approximate tracking - pool p keeps only its k largest origin fractions and folds the rest into the
+      *        untracked bucket after every mix, so memory and work per operation stay fixed however many origins mix in
+      * \param p pool the limit applies to
+      * \param k most origins kept explicitly (LAST, the default, is exact tracking)
+      */ 
+    static void setTopK(Pool p, int k);
+
+    /**
+      * \brief getter for the top-K limit of a pool
+      * \param p pool to check
+      * \return most origins p keeps explicitly
+      */ 
+    static int getTopK(Pool p);
+
+    /**
+      * \brief error bound on the attribution - the true carbon of any origin lies between getPoolCarbon and 
+      *        getPoolCarbon plus this bound, since the folded carbon is all that is unaccounted for
+      * \return unitval with units (pg C) - the carbon held in the untracked bucket
+      */ 
+    Hector::unitval getAttributionErrorBound();
+
      /**
       * \brief getter for static boolean track that shows if the carbon pools are tracking yet
       * \return boolean value of track object
@@ -149,6 +454,46 @@ using namespace std;
       */ 
     static void stopTracking();
 
+    /**
+      * \brief starts recording every flux, addition and subtraction to journal - the journal is not owned
+      * \param j FluxJournal to record to (null to stop journaling)
+      */ 
+    static void attachJournal(FluxJournal* j);
+
+    /**
+      * \brief getter for the journal transfers are currently recorded to
+      * \return pointer to the attached FluxJournal, null if not journaling
+      */ 
+    static FluxJournal* getJournal();
+
+    /**
+      * \brief starts recording every mixing step to tape for adjoint attribution - the tape is not owned. Needs
+      *        tracking on, since the tape attributes through each flux's origin fractions
+      * \param t AdjointTape to record to (null to stop recording)
+      */ 
+    static void attachTape(AdjointTape* t);
+
+    /**
+      * \brief getter for the tape mixing steps are currently recorded to
+      * \return pointer to the attached AdjointTape, null if not recording
+      */ 
+    static AdjointTape* getTape();
+
+    /**
+      * \brief sends deferred validation failures to s - the status is not owned
+      * \param s ValidationStatus to flag into (null for the default one)
+      */ 
+    static void attachStatus(ValidationStatus* s);
+
+    /**
+      * \brief getter for where deferred validation failures are flagged - only used when built with
+      *        CARBONTRACKER_DEFERRED_VALIDATION, otherwise the checks throw straight away
+      * \return the attached ValidationStatus
+      */ 
+    static ValidationStatus& getStatus(){
+        return *status;
+    }
+
     
 
    /**
@@ -166,6 +511,39 @@ using namespace std;
     * \return CarbonTracker object with total carbon set to flux and a map that is the same fluxProportions
     */ 
   CarbonTracker fluxFromTrackerPool(const Hector::unitval fluxAmount, double* fluxProportions);
+
+   /**
+    * \brief moves carbon from one pool to another in place - the same result (and journal and tape records) as
+    *        src.fluxFromTrackerPool(amount), src - flux, dst + flux, but in one pass with no temporaries. Exactly the
+    *        amount taken from src is added to dst, so the total carbon of the two is conserved
+    * \param src pool the carbon leaves
+    * \param dst pool the carbon enters - must be a different object than src
+    * \param amount unitval with units (pg C)
+    */ 
+  static void transfer(CarbonTracker& src, CarbonTracker& dst, const Hector::unitval amount);
+
+   /**
+    * \brief moves carbon made up of the given origin proportions from one pool to another in place - the fused
+    *        version of src.fluxFromTrackerPool(amount, fluxProportions), src - flux, dst + flux
+    * \param src pool the carbon leaves
+    * \param dst pool the carbon enters - must be a different object than src
+    * \param amount unitval with units (pg C)
+    * \param fluxProportions double array that hold proportions of each origin in the moved carbon
+    */ 
+  static void transfer(CarbonTracker& src, CarbonTracker& dst, const Hector::unitval amount, double* fluxProportions);
+
+   /**
+    * \brief linear exchange between two pools over one step, solved in closed form - da/dt = kba * b - kab * a and
+    *        the same for every origin, so totals and origin fractions are exact for constant rates and stay
+    *        stable (never overdrawn) at any step length. Applied as the two gross transfers, each sized and mixed
+    *        from the pools at the start of the step, so it is journaled and taped like any transfer
+    * \param a one pool
+    * \param b the other pool - must be a different object than a
+    * \param kab fraction of a's carbon moving to b per unit time
+    * \param kba fraction of b's carbon moving to a per unit time
+    * \param dt step length
+    */ 
+  static void exchange(CarbonTracker& a, CarbonTracker& b, double kab, double kba, double dt);
   
    /**
     * \brief Prints the total amount of carbon within each subpool 
@@ -174,6 +552,10 @@ using namespace std;
     * \return CarbonTracker object with total carbon set to flux and a map that is the same fluxProportions
     */ 
   friend ostream& operator<<(ostream &out, CarbonTracker &ct);
+
+  friend CarbonTracker operator*(const double d, CarbonTracker& ct);
+  friend CarbonTracker operator*(const CarbonTracker& ct, double d);
+  friend CarbonTracker operator/(CarbonTracker&, const double);
   };
 
 
@@ -205,4 +587,116 @@ using namespace std;
     */ 
   CarbonTracker operator/(CarbonTracker&, const double);
 
+
+#ifdef CARBONTRACKER_NO_TRACKING
+  // Tracking compiled out - nothing but the total carbon ever changes, so everything on the hot path is a copy
+  // plus a single unitval add or subtract that the compiler can see through
+
+  inline CarbonTracker::CarbonTracker(Hector::unitval totC, Pool subPool)
+    : totalCarbon(totC), homePool(subPool), journalRef(0xFFFFFFFF), tapeNode(0xFFFFFFFF),   // NO_REF, NO_NODE
+      untrackedFrac(tracksPool(subPool) && tracksOrigin(subPool) ? 0 : 1){
+    if(subPool == LAST){
+        checkFailed("LAST is not a sub-pool of carbon, it is just a marker for the end of the enum");
+    }
+    if(totC.units() != Hector::U_PGC){
+        checkFailed("Wrong Units. Carbin tracker only accepts U_PGC");
+    }
+    for(int i = 0; i < LAST; ++i){
+        originFracs[i] = i == subPool ? 1 - untrackedFrac : 0;
+    }
+  }
+
+  inline CarbonTracker::CarbonTracker(const CarbonTracker &ct) 
+    : totalCarbon(ct.totalCarbon), homePool(ct.homePool), journalRef(ct.journalRef), tapeNode(ct.tapeNode),
+      untrackedFrac(ct.untrackedFrac){
+    for(int i = 0; i < LAST; ++i){
+        originFracs[i] = ct.originFracs[i];
+    }
+  }
+
+  inline CarbonTracker& CarbonTracker::operator=(CarbonTracker ct){
+    totalCarbon = ct.totalCarbon;
+    homePool = ct.homePool;
+    journalRef = ct.journalRef;
+    tapeNode = ct.tapeNode;
+    untrackedFrac = ct.untrackedFrac;
+    for(int i = 0; i < LAST; ++i){
+        originFracs[i] = ct.originFracs[i];
+    }
+    return *this;
+  }
+
+  inline CarbonTracker CarbonTracker::withTotalCarbon(const Hector::unitval& totC) const{
+    CarbonTracker ct(*this);
+    ct.totalCarbon = totC;
+    return ct;
+  }
+
+  inline CarbonTracker CarbonTracker::operator+(const CarbonTracker& flux){
+    if(totalCarbon.units() != flux.totalCarbon.units()){
+        checkFailed("units mismatch");
+    }
+    return withTotalCarbon(Hector::unitval(double(totalCarbon) + double(flux.totalCarbon), totalCarbon.units()));
+  }
+
+  inline CarbonTracker CarbonTracker::operator-(const CarbonTracker& flux){
+    if(totalCarbon.units() != flux.totalCarbon.units()){
+        checkFailed("units mismatch");
+    }
+    return withTotalCarbon(Hector::unitval(double(totalCarbon) - double(flux.totalCarbon), totalCarbon.units()));
+  }
+
+  inline CarbonTracker CarbonTracker::operator-(const Hector::unitval flux){
+    if(totalCarbon.units() != flux.units()){
+        checkFailed("units mismatch");
+    }
+    return withTotalCarbon(Hector::unitval(double(totalCarbon) - double(flux), totalCarbon.units()));
+  }
+
+  inline CarbonTracker CarbonTracker::fluxFromTrackerPool(const Hector::unitval flux){
+    if(flux.units() != Hector::U_PGC){
+        checkFailed("Flux must be in units U_PGC for carbon tracker");
+    }
+    return withTotalCarbon(flux);
+  }
+
+  inline CarbonTracker CarbonTracker::fluxFromTrackerPool(const Hector::unitval fluxAmount, double*){
+    return fluxFromTrackerPool(fluxAmount);
+  }
+
+  inline void CarbonTracker::transfer(CarbonTracker& src, CarbonTracker& dst, const Hector::unitval amount){
+    if(amount.units() != Hector::U_PGC || src.totalCarbon.units() != amount.units() || dst.totalCarbon.units() != amount.units()){
+        checkFailed("Flux must be in units U_PGC for carbon tracker");
+    }
+    double moved = double(amount);
+    src.totalCarbon = Hector::unitval(double(src.totalCarbon) - moved, Hector::U_PGC);
+    dst.totalCarbon = Hector::unitval(double(dst.totalCarbon) + moved, Hector::U_PGC);
+  }
+
+  inline void CarbonTracker::transfer(CarbonTracker& src, CarbonTracker& dst, const Hector::unitval amount, double*){
+    transfer(src, dst, amount);
+  }
+
+  inline CarbonTracker operator*(const double d, CarbonTracker& ct){
+    return ct.withTotalCarbon(ct.totalCarbon * d);
+  }
+
+  inline CarbonTracker operator*(const CarbonTracker& ct, double d){
+    return ct.withTotalCarbon(ct.totalCarbon * d);
+  }
+
+  inline CarbonTracker operator/(CarbonTracker& ct, const double d){
+    H_ASSERT(d != 0, "No dividing by 0!");
+    return ct.withTotalCarbon(ct.totalCarbon / d);
+  }
+
+  inline Hector::unitval CarbonTracker::getTotalCarbon(){
+    return totalCarbon;
+  }
+
+  inline bool CarbonTracker::isTracking(){
+    return false;
+  }
+#endif
+
 #endif
@@ -0,0 +1,129 @@
+#include <exception>
+#include <string>
+#include "carbonTrackerC.h"
+#include "carbonTracker.hpp"
+
+using namespace std;
+
+static_assert(CT_SOIL == (int)CarbonTracker::SOIL && CT_ATMOSPHERE == (int)CarbonTracker::ATMOSPHERE && 
+              CT_DEEPOCEAN == (int)CarbonTracker::DEEPOCEAN && CT_TOPOCEAN == (int)CarbonTracker::TOPOCEAN && 
+              CT_N_POOLS == (int)CarbonTracker::LAST, "C ABI pool indices out of step with CarbonTracker::Pool");
+
+struct ct_tracker {
+    CarbonTracker ct;
+    ct_tracker(Hector::unitval carbon, CarbonTracker::Pool pool) : ct(carbon, pool){
+    }
+};
+
+// message of the calling thread's last failure
+static thread_local string lastError;
+
+// runs body, turning any exception into CT_ERROR and its message
+template<class BODY>
+static int guarded(BODY body){
+    try{
+        body();
+        return CT_OK;
+    }
+    catch(const std::exception& e){
+        lastError = e.what();
+    }
+    catch(...){
+        lastError = "Unknown exception";
+    }
+    return CT_ERROR;
+}
+
+static void checkHandles(ct_tracker* const* trackers, size_t n){
+    H_ASSERT(n == 0 || trackers, "NULL tracker array");
+    for(size_t i = 0; i < n; ++i){
+        H_ASSERT(trackers[i], "NULL tracker handle");
+    }
+}
+
+int ct_abi_version(void){
+    return CT_ABI_VERSION;
+}
+
+const char* ct_last_error(void){
+    return lastError.c_str();
+}
+
+int ct_start_tracking(void){
+    return guarded([](){
+        CarbonTracker::startTracking();
+    });
+}
+
+void ct_stop_tracking(void){
+    CarbonTracker::stopTracking();
+}
+
+ct_tracker* ct_create(double carbon, int pool){
+    ct_tracker* t = NULL;
+    guarded([&](){
+        H_ASSERT(pool >= 0 && pool < CT_N_POOLS, "Pool out of range");
+        t = new ct_tracker(Hector::unitval(carbon, Hector::U_PGC), (CarbonTracker::Pool)pool);
+    });
+    return t;
+}
+
+void ct_destroy(ct_tracker* t){
+    delete t;
+}
+
+int ct_read_carbon(ct_tracker* const* trackers, size_t n, double* out){
+    return guarded([&](){
+        checkHandles(trackers, n);
+        for(size_t i = 0; i < n; ++i){
+            out[i] = trackers[i]->ct.getTotalCarbon().value(Hector::U_PGC);
+        }
+    });
+}
+
+int ct_read_fractions(ct_tracker* const* trackers, size_t n, double* out, double* untracked){
+    return guarded([&](){
+        checkHandles(trackers, n);
+        for(size_t i = 0; i < n; ++i){
+            double* fracs = trackers[i]->ct.getOriginFracs();
+            for(int o = 0; o < CT_N_POOLS; ++o){
+                out[i * CT_N_POOLS + o] = fracs[o];
+            }
+            if(untracked){
+                untracked[i] = trackers[i]->ct.getUntrackedFrac();
+            }
+        }
+    });
+}
+
+int ct_apply_fluxes(ct_tracker* const* src, ct_tracker* const* dst, const double* amounts, size_t n){
+    return guarded([&](){
+        checkHandles(src, n);
+        checkHandles(dst, n);
+        for(size_t i = 0; i < n; ++i){
+            CarbonTracker::transfer(src[i]->ct, dst[i]->ct, Hector::unitval(amounts[i], Hector::U_PGC));
+        }
+    });
+}
+
+int ct_step(ct_tracker* const* pools, size_t nPools, const int* src, const int* dst, size_t nFluxes,
+            const double* amounts, size_t nSteps, double* totals){
+    return guarded([&](){
+        checkHandles(pools, nPools);
+        for(size_t f = 0; f < nFluxes; ++f){
+            H_ASSERT(src[f] >= 0 && (size_t)src[f] < nPools && dst[f] >= 0 && (size_t)dst[f] < nPools,
+                     "Flux pool index out of range");
+        }
+        for(size_t step = 0; step < nSteps; ++step){
+            const double* stepAmounts = amounts + step * nFluxes;
+            for(size_t f = 0; f < nFluxes; ++f){
+                CarbonTracker::transfer(pools[src[f]]->ct, pools[dst[f]]->ct, Hector::unitval(stepAmounts[f], Hector::U_PGC));
+            }
+            if(totals){
+                for(size_t p = 0; p < nPools; ++p){
+                    totals[step * nPools + p] = pools[p]->ct.getTotalCarbon().value(Hector::U_PGC);
+                }
+            }
+        }
+    });
+}
@@ -0,0 +1,81 @@
+#ifndef CARBONTRACKERC_H
+#define CARBONTRACKERC_H
+#include <stddef.h>
+
+/*
+ * C ABI for CarbonTracker, built into libcarbontracker by "make lib" - for R (.Call), Python (ctypes, cffi) and
+ * anything else with a C FFI. Trackers are opaque handles. The batch calls take arrays of handles and caller
+ * owned buffers, so a whole timestep (or N of them) costs one foreign call instead of one per operation.
+ *
+ * Every call that can fail returns CT_OK or CT_ERROR - no C++ exception ever crosses the ABI. ct_last_error
+ * gives the message of the calling thread's last failure. Carbon is always in Pg C, pools and origins are
+ * indices 0..CT_N_POOLS-1 in the CarbonTracker::Pool order.
+ */
+
+#if defined(_WIN32)
+#define CT_API __declspec(dllexport)
+#else
+#define CT_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* bumped whenever a signature or the meaning of a call changes */
+#define CT_ABI_VERSION 2
+
+#define CT_OK 0
+#define CT_ERROR -1
+
+enum {
+    CT_SOIL = 0,
+    CT_ATMOSPHERE = 1,
+    CT_DEEPOCEAN = 2,
+    CT_TOPOCEAN = 3,
+    CT_N_POOLS = 4
+};
+
+typedef struct ct_tracker ct_tracker;
+
+/* CT_ABI_VERSION the library was built with - check it against the header's */
+CT_API int ct_abi_version(void);
+
+/* message of the calling thread's last CT_ERROR, "" if none - valid until its next failing call */
+CT_API const char* ct_last_error(void);
+
+/* CT_ERROR if tracking was compiled out of the library */
+CT_API int ct_start_tracking(void);
+CT_API void ct_stop_tracking(void);
+
+/* new pool holding carbon Pg C, all of its own origin - NULL on error */
+CT_API ct_tracker* ct_create(double carbon, int pool);
+
+/* NULL is ignored */
+CT_API void ct_destroy(ct_tracker* t);
+
+/* total carbon of each of n trackers into out[n] */
+CT_API int ct_read_carbon(ct_tracker* const* trackers, size_t n, double* out);
+
+/*
+ * origin fractions of each of n trackers into out[n * CT_N_POOLS], tracker by tracker, and if untracked is not
+ * NULL the fraction no origin is kept for into untracked[n] - out and untracked together sum to 1 for each tracker
+ */
+CT_API int ct_read_fractions(ct_tracker* const* trackers, size_t n, double* out, double* untracked);
+
+/* moves amounts[i] Pg C from src[i] to dst[i] for i = 0..n-1, in order - stops at the first failure */
+CT_API int ct_apply_fluxes(ct_tracker* const* src, ct_tracker* const* dst, const double* amounts, size_t n);
+
+/*
+ * Steps the pools nSteps timesteps. Each step moves amounts[step * nFluxes + f] Pg C from pools[src[f]] to
+ * pools[dst[f]] for f = 0..nFluxes-1, in order. If totals is not NULL, every pool's total carbon after each step
+ * goes to totals[step * nPools + p]. Stops at the first failure.
+ */
+CT_API int ct_step(ct_tracker* const* pools, size_t nPools, const int* src, const int* dst, size_t nFluxes,
+                   const double* amounts, size_t nSteps, double* totals);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,335 @@
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include "compressedHistory.hpp"
+
+using namespace std;
+
+const int CompressedHistory::COLUMNS;
+
+static uint64_t toBits(double d){
+    uint64_t u;
+    memcpy(&u, &d, sizeof(u));
+    return u;
+}
+
+static double fromBits(uint64_t u){
+    double d;
+    memcpy(&d, &u, sizeof(d));
+    return d;
+}
+
+// x is never 0 here
+static int leadingZeros(uint64_t x){
+#if defined(__GNUC__)
+    return __builtin_clzll(x);
+#else
+    int n = 0;
+    for(; !(x & 0x8000000000000000ULL); x <<= 1){
+        ++n;
+    }
+    return n;
+#endif
+}
+
+static int trailingZeros(uint64_t x){
+#if defined(__GNUC__)
+    return __builtin_ctzll(x);
+#else
+    int n = 0;
+    for(; !(x & 1); x >>= 1){
+        ++n;
+    }
+    return n;
+#endif
+}
+
+
+CompressedHistory::BitWriter::BitWriter() : acc(0), nAcc(0){
+}
+
+void CompressedHistory::BitWriter::write(uint64_t value, int nBits){
+    while(nBits > 0){
+        int take = nBits < 8 - nAcc ? nBits : 8 - nAcc;
+        nBits -= take;
+        acc = (acc << take) | ((value >> nBits) & ((1u << take) - 1));
+        nAcc += take;
+        if(nAcc == 8){
+            bytes.push_back((uint8_t)acc);
+            acc = 0;
+            nAcc = 0;
+        }
+    }
+}
+
+vector<uint8_t> CompressedHistory::BitWriter::finish() const{
+    vector<uint8_t> out(bytes);
+    if(nAcc > 0){
+        out.push_back((uint8_t)(acc << (8 - nAcc)));
+    }
+    return out;
+}
+
+void CompressedHistory::BitWriter::clear(){
+    bytes.clear();
+    acc = 0;
+    nAcc = 0;
+}
+
+CompressedHistory::BitReader::BitReader(const uint8_t* data) : data(data), pos(0){
+}
+
+uint64_t CompressedHistory::BitReader::read(int nBits){
+    uint64_t value = 0;
+    while(nBits > 0){
+        int room = 8 - (pos & 7);
+        int take = nBits < room ? nBits : room;
+        value = (value << take) | ((data[pos >> 3] >> (room - take)) & ((1u << take) - 1));
+        pos += take;
+        nBits -= take;
+    }
+    return value;
+}
+
+
+// Gorilla XOR encoding against reference:
+//   0                                    same as the reference
+//   10 <bits>                            changed bits fit in the last window
+//   11 <5 bits lead> <6 bits len-1> <bits> new window
+void CompressedHistory::encode(BitWriter& bits, XorState& s, uint64_t value, uint64_t reference){
+    uint64_t x = value ^ reference;
+    s.prev = value;
+    if(x == 0){
+        bits.write(0, 1);
+        return;
+    }
+    int lead = leadingZeros(x);
+    int trail = trailingZeros(x);
+    if(lead > 31){
+        lead = 31;
+    }
+    if(s.leading >= 0 && lead >= s.leading && trail >= s.trailing){
+        bits.write(2, 2);
+        bits.write(x >> s.trailing, 64 - s.leading - s.trailing);
+    }
+    else{
+        int len = 64 - lead - trail;
+        bits.write(3, 2);
+        bits.write(lead, 5);
+        bits.write(len - 1, 6);
+        bits.write(x >> trail, len);
+        s.leading = lead;
+        s.trailing = trail;
+    }
+}
+
+uint64_t CompressedHistory::decode(BitReader& bits, XorState& s, uint64_t reference){
+    uint64_t x = 0;
+    if(bits.read(1)){
+        if(bits.read(1)){
+            s.leading = (int)bits.read(5);
+            int len = (int)bits.read(6) + 1;
+            s.trailing = 64 - s.leading - len;
+        }
+        x = bits.read(64 - s.leading - s.trailing) << s.trailing;
+    }
+    s.prev = reference ^ x;
+    return s.prev;
+}
+
+void CompressedHistory::resetOpen(OpenBlock& b){
+    b.bits.clear();
+    b.count = 0;
+    b.time.leading = -1;
+    for(int c = 0; c < COLUMNS; ++c){
+        b.columns[c].leading = -1;
+    }
+}
+
+
+CompressedHistory::CompressedHistory(size_t blockSnapshots) : blockSnapshots(blockSnapshots), sealedBytes(0), streamEnd(0){
+    H_ASSERT(blockSnapshots > 0, "History blocks need at least one snapshot");
+    for(int p = 0; p < CarbonTracker::LAST; ++p){
+        resetOpen(open[p]);
+        counts[p] = 0;
+    }
+}
+
+CompressedHistory::CompressedHistory(const string& path, size_t blockSnapshots)
+    : blockSnapshots(blockSnapshots), sealedBytes(0), streamEnd(0){
+    H_ASSERT(blockSnapshots > 0, "History blocks need at least one snapshot");
+    stream.open(path.c_str(), ios::binary | ios::in | ios::out | ios::trunc);
+    H_ASSERT(stream.is_open(), "Could not open history file " + path);
+    for(int p = 0; p < CarbonTracker::LAST; ++p){
+        resetOpen(open[p]);
+        counts[p] = 0;
+    }
+}
+
+void CompressedHistory::record(double time, CarbonTracker& ct){
+    CarbonTracker::Pool pool = ct.getHomePool();
+    H_ASSERT(pool != CarbonTracker::LAST, "Can only record the history of a pool");
+    OpenBlock& b = open[pool];
+    H_ASSERT(counts[pool] == 0 || time > (b.count ? b.lastTime : blocks[pool].back().lastTime),
+             "History snapshots must be recorded in time order");
+
+    double values[COLUMNS];
+    values[0] = ct.getTotalCarbon().value(Hector::U_PGC);
+    double* fracs = ct.getOriginFracs();
+    for(int o = 0; o < CarbonTracker::LAST; ++o){
+        values[1 + o] = fracs[o];
+    }
+    values[COLUMNS - 1] = ct.getUntrackedFrac();
+
+    if(b.count == 0){
+        // first snapshot of a block is stored raw so the block decodes on its own
+        b.bits.write(toBits(time), 64);
+        b.time.prev = toBits(time);
+        for(int c = 0; c < COLUMNS; ++c){
+            b.bits.write(toBits(values[c]), 64);
+            b.columns[c].prev = toBits(values[c]);
+        }
+        b.firstTime = time;
+        b.prevDelta = 0;
+    }
+    else{
+        // times are usually evenly spaced, so predict the next from the last step
+        encode(b.bits, b.time, toBits(time), toBits(b.prevTime + b.prevDelta));
+        for(int c = 0; c < COLUMNS; ++c){
+            encode(b.bits, b.columns[c], toBits(values[c]), b.columns[c].prev);
+        }
+        b.prevDelta = time - b.prevTime;
+    }
+    b.prevTime = time;
+    b.lastTime = time;
+    ++b.count;
+    ++counts[pool];
+    if(b.count == blockSnapshots){
+        seal(pool);
+    }
+}
+
+void CompressedHistory::seal(int pool){
+    OpenBlock& b = open[pool];
+    Block sealed;
+    sealed.firstTime = b.firstTime;
+    sealed.lastTime = b.lastTime;
+    sealed.count = b.count;
+    sealed.data = b.bits.finish();
+    sealed.bytes = sealed.data.size();
+    sealed.offset = streamEnd;
+    if(stream.is_open()){
+        stream.seekp(streamEnd);
+        stream.write((const char*)&sealed.data[0], sealed.bytes);
+        streamEnd += sealed.bytes;
+        vector<uint8_t>().swap(sealed.data);
+    }
+    sealedBytes += sealed.bytes;
+    blocks[pool].push_back(sealed);
+    resetOpen(b);
+}
+
+void CompressedHistory::decodeBlock(const uint8_t* data, uint32_t count, double t0, double t1, vector<Snapshot>& out){
+    BitReader bits(data);
+    XorState time;
+    XorState columns[COLUMNS];
+    double prevTime = 0, prevDelta = 0;
+    time.leading = -1;
+    for(int c = 0; c < COLUMNS; ++c){
+        columns[c].leading = -1;
+    }
+    for(uint32_t i = 0; i < count; ++i){
+        double t;
+        double values[COLUMNS];
+        if(i == 0){
+            t = fromBits(bits.read(64));
+            for(int c = 0; c < COLUMNS; ++c){
+                columns[c].prev = bits.read(64);
+                values[c] = fromBits(columns[c].prev);
+            }
+        }
+        else{
+            t = fromBits(decode(bits, time, toBits(prevTime + prevDelta)));
+            for(int c = 0; c < COLUMNS; ++c){
+                values[c] = fromBits(decode(bits, columns[c], columns[c].prev));
+            }
+            prevDelta = t - prevTime;
+        }
+        prevTime = t;
+        if(t > t1){
+            break;
+        }
+        if(t >= t0){
+            Snapshot s;
+            s.time = t;
+            s.totalCarbon = values[0];
+            for(int o = 0; o < CarbonTracker::LAST; ++o){
+                s.originFracs[o] = values[1 + o];
+            }
+            s.untrackedFrac = values[COLUMNS - 1];
+            out.push_back(s);
+        }
+    }
+}
+
+vector<CompressedHistory::Snapshot> CompressedHistory::query(CarbonTracker::Pool pool, double t0, double t1){
+    H_ASSERT(pool != CarbonTracker::LAST, "LAST is not a sub-pool of carbon, it is just a marker for the end of the enum");
+    vector<Snapshot> out;
+    const vector<Block>& sealed = blocks[pool];
+
+    // first block that ends at or after t0
+    size_t lo = 0, hi = sealed.size();
+    while(lo < hi){
+        size_t mid = (lo + hi) / 2;
+        if(sealed[mid].lastTime < t0){
+            lo = mid + 1;
+        }
+        else{
+            hi = mid;
+        }
+    }
+    vector<uint8_t> buffer;
+    for(size_t k = lo; k < sealed.size() && sealed[k].firstTime <= t1; ++k){
+        const Block& blk = sealed[k];
+        // a streamed block keeps no bytes in memory - its data vector is empty
+        const uint8_t* data;
+        if(stream.is_open()){
+            buffer.resize(blk.bytes);
+            stream.flush();
+            stream.seekg(blk.offset);
+            stream.read((char*)&buffer[0], blk.bytes);
+            data = &buffer[0];
+        }
+        else{
+            data = &blk.data[0];
+        }
+        decodeBlock(data, blk.count, t0, t1, out);
+    }
+
+    const OpenBlock& b = open[pool];
+    if(b.count > 0 && b.lastTime >= t0 && b.firstTime <= t1){
+        vector<uint8_t> bytes = b.bits.finish();
+        decodeBlock(&bytes[0], b.count, t0, t1, out);
+    }
+    return out;
+}
+
+size_t CompressedHistory::size(CarbonTracker::Pool pool) const{
+    return counts[pool];
+}
+
+size_t CompressedHistory::compressedBytes() const{
+    size_t bytes = sealedBytes;
+    for(int p = 0; p < CarbonTracker::LAST; ++p){
+        bytes += open[p].bits.bytes.size() + (open[p].bits.nAcc > 0);
+    }
+    return bytes;
+}
+
+size_t CompressedHistory::rawBytes() const{
+    size_t n = 0;
+    for(int p = 0; p < CarbonTracker::LAST; ++p){
+        n += counts[p];
+    }
+    return n * (1 + COLUMNS) * sizeof(double);
+}
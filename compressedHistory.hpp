@@ -0,0 +1,176 @@
+#ifndef COMPRESSEDHISTORY_HPP
+#define COMPRESSEDHISTORY_HPP
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "carbonTracker.hpp"
+
+using namespace std;
+
+  /**
+   * \brief CompressedHistory Class: lossless, compressed store of every pool's snapshots (time, total carbon,
+   *        origin fractions and untracked fraction) over a run
+   *
+   * Snapshots are compressed as they are recorded, Gorilla style: each value is XORed with the previous value
+   * of its column (times with the time the previous step predicts) and only the changed bits are written, so a
+   * fraction that doesn't move costs one bit and a slowly varying one only its low order bits. Every
+   * blockSnapshots snapshots of a pool are sealed into a block that decodes on its own - a time range query only
+   * decodes the blocks that overlap it. Given a path, sealed blocks are streamed to that file and only their index
+   * stays in memory. Every double comes back bit for bit
+   */
+  class CompressedHistory{
+   public:
+
+    // One decoded snapshot
+    struct Snapshot {
+      double time;
+      double totalCarbon;                           // pg C
+      double originFracs[CarbonTracker::LAST];
+      double untrackedFrac;
+    };
+
+   private:
+
+    // values compressed per snapshot after the time - total carbon, the origin fractions and the untracked fraction
+    static const int COLUMNS = CarbonTracker::LAST + 2;
+
+    // bits appended most significant first
+    class BitWriter{
+     public:
+      vector<uint8_t> bytes;
+      uint64_t acc;     // bits not yet in bytes, right aligned
+      int nAcc;         // number of bits in acc (< 8 between calls)
+      BitWriter();
+      void write(uint64_t value, int nBits);
+      // bytes written so far plus the partial byte, ready to be read back
+      vector<uint8_t> finish() const;
+      void clear();
+    };
+
+    class BitReader{
+     public:
+      const uint8_t* data;
+      size_t pos;       // in bits
+      BitReader(const uint8_t* data);
+      uint64_t read(int nBits);
+    };
+
+    // XOR state of one column within a block
+    struct XorState {
+      uint64_t prev;
+      int leading;      // leading zeros of the last window written - -1 before the first
+      int trailing;
+    };
+
+    // sealed block of one pool's snapshots
+    struct Block {
+      double firstTime;
+      double lastTime;
+      uint32_t count;
+      uint64_t offset;          // in the stream file, when streaming
+      vector<uint8_t> data;     // compressed bits, when not streaming
+      uint32_t bytes;
+    };
+
+    // block being filled for one pool
+    struct OpenBlock {
+      BitWriter bits;
+      uint32_t count;
+      double firstTime;
+      double lastTime;
+      double prevTime;
+      double prevDelta;
+      XorState time;
+      XorState columns[COLUMNS];
+    };
+
+    // snapshots per block
+    size_t blockSnapshots;
+
+    // sealed blocks of each pool in time order
+    vector<Block> blocks[CarbonTracker::LAST];
+
+    // block being filled for each pool
+    OpenBlock open[CarbonTracker::LAST];
+
+    // snapshots recorded for each pool
+    size_t counts[CarbonTracker::LAST];
+
+    // compressed bytes of the sealed blocks
+    size_t sealedBytes;
+
+    // where sealed blocks are streamed - not open when they are kept in memory
+    fstream stream;
+    uint64_t streamEnd;
+
+    // Make the copy constructs private and undefined - the stream file has one writer
+    CompressedHistory(const CompressedHistory&);
+    CompressedHistory& operator=(const CompressedHistory&);
+
+    static void resetOpen(OpenBlock& b);
+    static void encode(BitWriter& bits, XorState& s, uint64_t value, uint64_t reference);
+    static uint64_t decode(BitReader& bits, XorState& s, uint64_t reference);
+
+    /**
+      * \brief seals the open block of a pool - streams it out if streaming
+      */
+    void seal(int pool);
+
+    /**
+      * \brief decodes a block's snapshots in [t0, t1] onto out
+      */
+    static void decodeBlock(const uint8_t* data, uint32_t count, double t0, double t1, vector<Snapshot>& out);
+
+   public:
+
+    /**
+      * \brief constructor - keeps every block in memory
+      * \param blockSnapshots snapshots of a pool per block - the unit of random access
+      */
+    CompressedHistory(size_t blockSnapshots = 512);
+
+    /**
+      * \brief constructor - streams sealed blocks to a file as the run goes, only the block index stays in memory
+      * \param path file the blocks are written to (replaced if it exists)
+      * \param blockSnapshots snapshots of a pool per block - the unit of random access
+      */
+    CompressedHistory(const string& path, size_t blockSnapshots = 512);
+
+    /**
+      * \brief appends a snapshot of a pool - times must increase for each pool
+      * \param time model time of the snapshot (e.g. year)
+      * \param ct pool to record - its home pool decides which series it is stored in
+      */
+    void record(double time, CarbonTracker& ct);
+
+    /**
+      * \brief snapshots of a pool with t0 <= time <= t1, decoded exactly - only blocks that overlap are read
+      * \param pool pool to query
+      * \param t0 start of the range
+      * \param t1 end of the range
+      * \return snapshots in time order
+      */
+    vector<Snapshot> query(CarbonTracker::Pool pool, double t0, double t1);
+
+    /**
+      * \brief getter for number of snapshots recorded for a pool
+      * \param pool pool to query
+      * \return snapshot count
+      */
+    size_t size(CarbonTracker::Pool pool) const;
+
+    /**
+      * \brief getter for the compressed size of everything recorded, including the blocks still being filled
+      * \return bytes
+      */
+    size_t compressedBytes() const;
+
+    /**
+      * \brief getter for the size everything recorded would take as raw doubles
+      * \return bytes
+      */
+    size_t rawBytes() const;
+  };
+
+#endif
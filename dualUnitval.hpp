@@ -0,0 +1,191 @@
+#ifndef DUALUNITVAL_HPP
+#define DUALUNITVAL_HPP
+/*
+ *  dualUnitval.hpp - forward-mode derivatives for unitval arithmetic
+ *
+ *  A dual number carries a value plus N derivative lanes (one per model
+ *  parameter). The lanes are a plain contiguous array walked with fixed
+ *  trip count loops, so the compiler vectorizes them and N parameters
+ *  cost one pass instead of N finite difference runs.
+ */
+
+#include <sstream>
+
+#include "unitval.hpp"
+
+namespace Hector {
+
+/*! \brief A value with N derivative lanes and no units.
+ */
+template<int N>
+struct dual {
+    double val;
+    double d[N];
+
+    dual() : val( 0.0 ) { for( int i = 0; i < N; ++i ) d[i] = 0.0; }
+    dual( double v ) : val( v ) { for( int i = 0; i < N; ++i ) d[i] = 0.0; }
+
+    /*! \brief A value that is parameter 'lane' itself (derivative 1 in that lane).
+     */
+    static dual variable( double v, int lane ) {
+        dual x( v );
+        x.d[lane] = 1.0;
+        return x;
+    }
+};
+
+template<int N>
+inline dual<N> operator+ ( const dual<N>& lhs, const dual<N>& rhs ) {
+    dual<N> r( lhs.val + rhs.val );
+    for( int i = 0; i < N; ++i ) r.d[i] = lhs.d[i] + rhs.d[i];
+    return r;
+}
+
+template<int N>
+inline dual<N> operator- ( const dual<N>& lhs, const dual<N>& rhs ) {
+    dual<N> r( lhs.val - rhs.val );
+    for( int i = 0; i < N; ++i ) r.d[i] = lhs.d[i] - rhs.d[i];
+    return r;
+}
+
+template<int N>
+inline dual<N> operator* ( const dual<N>& lhs, const dual<N>& rhs ) {
+    dual<N> r( lhs.val * rhs.val );
+    for( int i = 0; i < N; ++i ) r.d[i] = lhs.d[i] * rhs.val + lhs.val * rhs.d[i];
+    return r;
+}
+
+template<int N>
+inline dual<N> operator/ ( const dual<N>& lhs, const dual<N>& rhs ) {
+    const double inv = 1.0 / rhs.val;
+    dual<N> r( lhs.val * inv );
+    for( int i = 0; i < N; ++i ) r.d[i] = ( lhs.d[i] - r.val * rhs.d[i] ) * inv;
+    return r;
+}
+
+template<int N>
+inline dual<N> operator* ( const dual<N>& lhs, const double rhs ) {
+    dual<N> r( lhs.val * rhs );
+    for( int i = 0; i < N; ++i ) r.d[i] = lhs.d[i] * rhs;
+    return r;
+}
+
+template<int N>
+inline dual<N> operator* ( const double lhs, const dual<N>& rhs ) {
+    return rhs * lhs;
+}
+
+template<int N>
+inline dual<N> operator/ ( const dual<N>& lhs, const double rhs ) {
+    return lhs * ( 1.0 / rhs );
+}
+
+/*! \brief Lanes for the carbon tracking rules: the derivatives follow the
+ *  value, so origins are picked by the value and folded whole.
+ */
+template<int N>
+inline int foldLanes( const dual<N>& ) {
+    return 1;
+}
+
+template<int N>
+inline double laneValue( const dual<N>& f, int ) {
+    return f.val;
+}
+
+template<int N>
+inline void moveLane( dual<N>& to, dual<N>& from, int ) {
+    to = to + from;
+    from = dual<N>( 0.0 );
+}
+
+/*! \brief A unitval whose value carries N derivative lanes.
+ *
+ *  Mirrors the unitval operators: units are checked once per operation,
+ *  lanes ride along. Use dualUnitval<N>::lanes_type for unitless factors.
+ */
+template<int N>
+class dualUnitval {
+
+    dual<N>     val;
+    unit_types  valUnits;
+
+public:
+    typedef dual<N> lanes_type;
+
+    dualUnitval() : valUnits( U_UNDEFINED ) {}
+    dualUnitval( double v, unit_types u ) : val( v ), valUnits( u ) {}
+    dualUnitval( const dual<N>& v, unit_types u ) : val( v ), valUnits( u ) {}
+
+    /*! \brief A unitval that is parameter 'lane' itself.
+     */
+    static dualUnitval variable( double v, unit_types u, int lane ) {
+        return dualUnitval( dual<N>::variable( v, lane ), u );
+    }
+
+    double value( unit_types u ) const {
+        H_ASSERT( u==valUnits, "variable is not of this type.  Expected: " + unitval::unitsName(valUnits) +
+                 "; got: " + unitval::unitsName(u) );
+        return val.val;
+    }
+    double deriv( int lane ) const { return val.d[lane]; }
+    const dual<N>& lanes() const { return val; }
+    unit_types units() const { return valUnits; }
+};
+
+template<int N>
+inline dualUnitval<N> operator+ ( const dualUnitval<N>& lhs, const dualUnitval<N>& rhs ) {
+    H_ASSERT( lhs.units()==rhs.units(), "units mismatch" );
+    return dualUnitval<N>( lhs.lanes() + rhs.lanes(), lhs.units() );
+}
+
+template<int N>
+inline dualUnitval<N> operator- ( const dualUnitval<N>& lhs, const dualUnitval<N>& rhs ) {
+    H_ASSERT( lhs.units()==rhs.units(), "units mismatch" );
+    return dualUnitval<N>( lhs.lanes() - rhs.lanes(), lhs.units() );
+}
+
+template<int N>
+inline dualUnitval<N> operator* ( const dualUnitval<N>& lhs, const dual<N>& rhs ) {
+    return dualUnitval<N>( lhs.lanes() * rhs, lhs.units() );
+}
+
+template<int N>
+inline dualUnitval<N> operator* ( const dual<N>& lhs, const dualUnitval<N>& rhs ) {
+    return dualUnitval<N>( lhs * rhs.lanes(), rhs.units() );
+}
+
+template<int N>
+inline dualUnitval<N> operator* ( const dualUnitval<N>& lhs, const double rhs ) {
+    return dualUnitval<N>( lhs.lanes() * rhs, lhs.units() );
+}
+
+template<int N>
+inline dualUnitval<N> operator* ( const double lhs, const dualUnitval<N>& rhs ) {
+    return dualUnitval<N>( rhs.lanes() * lhs, rhs.units() );
+}
+
+template<int N>
+inline dualUnitval<N> operator/ ( const dualUnitval<N>& lhs, const double rhs ) {
+    return dualUnitval<N>( lhs.lanes() / rhs, lhs.units() );
+}
+
+/*! \brief Divide two dualUnitvals. Must be of the same type, returning a unitless dual.
+ */
+template<int N>
+inline dual<N> operator/ ( const dualUnitval<N>& lhs, const dualUnitval<N>& rhs ) {
+    H_ASSERT( lhs.units()==rhs.units(), "units mismatch" );
+    return lhs.lanes() / rhs.lanes();
+}
+
+template<int N>
+inline std::ostream& operator<<( std::ostream &out, const dualUnitval<N> &x ) {
+    out << x.value( x.units() ) << " " << unitval::unitsName( x.units() ) << " d[";
+    for( int i = 0; i < N; ++i ) out << ( i ? " " : "" ) << x.deriv( i );
+    out << "]";
+    return out;
+}
+
+}
+
+#endif
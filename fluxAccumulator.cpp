@@ -0,0 +1,81 @@
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include "fluxAccumulator.hpp"
+#include "tracer.hpp"
+
+using namespace std;
+
+thread_local FluxAccumulator::Cache FluxAccumulator::cache = {0, NULL};
+
+// guards every accumulator's slot registry
+static mutex registryLock;
+
+// ids of accumulators and threads - 0 is never handed out, so an empty cache matches nothing
+static atomic<uint64_t> nextId(1);
+static atomic<uint64_t> nextThread(1);
+static thread_local uint64_t threadNumber = 0;
+
+FluxAccumulator::FluxAccumulator() : id(nextId++){
+}
+
+FluxAccumulator::~FluxAccumulator(){
+    for(size_t t = 0; t < raw.size(); ++t){
+        delete[] raw[t];
+    }
+}
+
+FluxAccumulator::Slot* FluxAccumulator::registerThread(){
+    if(threadNumber == 0){
+        threadNumber = nextThread++;
+    }
+    lock_guard<mutex> lock(registryLock);
+    // a thread switching between accumulators comes back here - it keeps the slot it already has
+    for(size_t t = 0; t < threads.size(); ++t){
+        if(threads[t] == threadNumber){
+            cache.owner = id;
+            cache.slot = slots[t];
+            return slots[t];
+        }
+    }
+    // new doesn't promise more than 16 byte alignment before C++17, so line the slot up by hand
+    char* memory = new char[sizeof(Slot) + alignof(Slot)];
+    Slot* s = reinterpret_cast<Slot*>((reinterpret_cast<uintptr_t>(memory) + alignof(Slot) - 1) & ~(uintptr_t)(alignof(Slot) - 1));
+    memset(s, 0, sizeof(Slot));
+    raw.push_back(memory);
+    slots.push_back(s);
+    threads.push_back(threadNumber);
+    cache.owner = id;
+    cache.slot = s;
+    return s;
+}
+
+void FluxAccumulator::merge(CarbonTracker& pool){
+    CT_TRACE_SPAN("FluxAccumulator::merge", "tracker");
+    CarbonTracker::Pool dst = pool.getHomePool();
+    H_ASSERT(dst != CarbonTracker::LAST, "Can only merge into a pool");
+    double sums[COLUMNS] = {0};
+    bool any = false;
+    for(size_t t = 0; t < slots.size(); ++t){
+        Slot& s = *slots[t];
+        if(!s.deposited[dst]){
+            continue;
+        }
+        for(int c = 0; c < COLUMNS; ++c){
+            sums[c] += s.carbon[dst][c];
+            s.carbon[dst][c] = 0;
+        }
+        s.deposited[dst] = false;
+        any = true;
+    }
+    double total = sums[CarbonTracker::LAST + 1];
+    if(!any || total == 0){
+        return;
+    }
+    double fracs[CarbonTracker::LAST];
+    for(int o = 0; o < CarbonTracker::LAST; ++o){
+        fracs[o] = sums[o] / total;
+    }
+    pool = pool + CarbonTracker(Hector::unitval(total, Hector::U_PGC), fracs, CarbonTracker::LAST,
+                                sums[CarbonTracker::LAST] / total);
+}
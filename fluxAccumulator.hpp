@@ -0,0 +1,95 @@
+#ifndef FLUXACCUMULATOR_HPP
+#define FLUXACCUMULATOR_HPP
+#include <vector>
+#include <stdint.h>
+#include "carbonTracker.hpp"
+
+using namespace std;
+
+  /**
+   * \brief FluxAccumulator Class: collects the fluxes several threads deposit into the same pools during a step,
+   *        without a lock, and adds them to the pools in one pass at the end of the step
+   *
+   * Each thread deposits into its own cache line aligned slot, which holds the origin resolved carbon per
+   * destination pool. merge, called once the depositing threads are done (e.g. after a join), adds up every
+   * thread's slot for a pool and adds the result with a single operator+ - so the pool is journaled and taped
+   * once per step instead of once per flux. Slots are added in the order threads first deposited; use
+   * FluxReduction where the result must not depend on the thread count
+   */
+  class FluxAccumulator{
+   private:
+
+    // one thread's deposits - origin carbon, then untracked carbon, then total carbon, per destination pool
+    static const int COLUMNS = CarbonTracker::LAST + 2;
+    struct alignas(64) Slot {
+      double carbon[CarbonTracker::LAST][COLUMNS];
+      bool deposited[CarbonTracker::LAST];
+    };
+
+    // the calling thread's slot of the accumulator it last deposited to
+    struct Cache {
+      uint64_t owner;
+      Slot* slot;
+    };
+    static thread_local Cache cache;
+
+    // identifies this accumulator in the thread caches - never reused
+    uint64_t id;
+
+    // every thread's slot in registration order, the thread it belongs to and the memory it sits in
+    vector<Slot*> slots;
+    vector<uint64_t> threads;
+    vector<char*> raw;
+
+    // Make the copy constructs private and undefined - the slots belong to one accumulator
+    FluxAccumulator(const FluxAccumulator&);
+    FluxAccumulator& operator=(const FluxAccumulator&);
+
+    /**
+      * \brief finds or creates the calling thread's slot - takes the registration lock
+      */
+    Slot* registerThread();
+
+    Slot& slot(){
+        return cache.owner == id ? *cache.slot : *registerThread();
+    }
+
+   public:
+
+    FluxAccumulator();
+    ~FluxAccumulator();
+
+    /**
+      * \brief adds a flux to what the calling thread has deposited into a pool this step
+      * \param dst destination pool
+      * \param flux carbon deposited - e.g. from fluxFromTrackerPool
+      */
+    void deposit(CarbonTracker::Pool dst, const CarbonTracker& flux){
+        H_ASSERT(dst != CarbonTracker::LAST, "LAST is not a sub-pool of carbon, it is just a marker for the end of the enum");
+        Slot& s = slot();
+        double total = double(flux.totalCarbon);
+        double* carbon = s.carbon[dst];
+        for(int o = 0; o < CarbonTracker::LAST; ++o){
+            carbon[o] += flux.originFracs[o] * total;
+        }
+        carbon[CarbonTracker::LAST] += flux.untrackedFrac * total;
+        carbon[CarbonTracker::LAST + 1] += total;
+        s.deposited[dst] = true;
+    }
+
+    /**
+      * \brief adds everything deposited into pool's home pool by every thread to pool and clears it - no thread
+      *        may be depositing while this runs
+      * \param pool pool to merge into
+      */
+    void merge(CarbonTracker& pool);
+
+    /**
+      * \brief getter for the number of threads that have deposited
+      */
+    size_t threadCount() const{
+        return slots.size();
+    }
+  };
+
+#endif
@@ -0,0 +1,150 @@
+#include <cstring>
+#include <fstream>
+#include <vector>
+#include "fluxJournal.hpp"
+#include "tracer.hpp"
+
+using namespace std;
+
+const uint32_t FluxJournal::NO_REF;
+
+// records kept in memory before being written in one go
+const size_t JOURNAL_BUFFER_RECORDS = 4096;
+
+FluxJournal::FluxJournal(const string& path) : out(path.c_str(), ios::binary | ios::trunc), count(0), timestep(0){
+    H_ASSERT(out.is_open(), "Could not open flux journal " + path);
+    buffer.reserve(JOURNAL_BUFFER_RECORDS);
+}
+
+FluxJournal::~FluxJournal(){
+    flush();
+}
+
+void FluxJournal::setTimestep(uint32_t t){
+    this->timestep = t;
+}
+
+uint32_t FluxJournal::record(Op op, CarbonTracker::Pool source, CarbonTracker::Pool dest, double amount, uint32_t ref){
+    // zeroed so the padding after dest is written as 0s, not whatever was on the stack
+    Record r;
+    memset(&r, 0, sizeof(Record));
+    r.amount = amount;
+    r.timestep = this->timestep;
+    r.ref = ref;
+    r.op = (uint8_t)op;
+    r.source = (uint8_t)source;
+    r.dest = (uint8_t)dest;
+    buffer.push_back(r);
+    if(buffer.size() >= JOURNAL_BUFFER_RECORDS){
+        flush();
+    }
+    return count++;
+}
+
+void FluxJournal::flush(){
+    CT_TRACE_SPAN("FluxJournal::flush", "io");
+    CT_TRACE_COUNTER("journal records", count);
+    if(!buffer.empty()){
+        out.write((const char*)&buffer[0], buffer.size() * sizeof(Record));
+        out.flush();
+        buffer.clear();
+    }
+}
+
+uint32_t FluxJournal::size() const{
+    return count;
+}
+
+vector<FluxJournal::Record> FluxJournal::readRecords(const string& path){
+    CT_TRACE_SPAN("FluxJournal::readRecords", "io");
+    ifstream in(path.c_str(), ios::binary | ios::ate);
+    H_ASSERT(in.is_open(), "Could not open flux journal " + path);
+    streamsize bytes = in.tellg();
+    H_ASSERT(bytes % sizeof(Record) == 0, "Flux journal " + path + " is truncated");
+    vector<Record> records(bytes / sizeof(Record));
+    in.seekg(0);
+    if(!records.empty()){
+        in.read((char*)&records[0], bytes);
+    }
+    return records;
+}
+
+
+FluxReplay::FluxReplay(int nOrigins) : nOrigins(nOrigins), masses(CarbonTracker::LAST * nOrigins, 0.0){
+    H_ASSERT(nOrigins > 0, "Replay needs at least one origin");
+    for(int i = 0; i < CarbonTracker::LAST; ++i){
+        totals[i] = 0;
+    }
+}
+
+void FluxReplay::setInitialPool(CarbonTracker::Pool pool, double totalCarbon, const double* originFracs){
+    H_ASSERT(pool != CarbonTracker::LAST, "LAST is not a sub-pool of carbon, it is just a marker for the end of the enum");
+    totals[pool] = totalCarbon;
+    for(int o = 0; o < nOrigins; ++o){
+        masses[pool * nOrigins + o] = totalCarbon * originFracs[o];
+    }
+}
+
+void FluxReplay::move(int pool, double amount, const double* fracs){
+    double* m = &masses[pool * nOrigins];
+    for(int o = 0; o < nOrigins; ++o){
+        m[o] += amount * fracs[o];
+    }
+    totals[pool] += amount;
+}
+
+void FluxReplay::replay(const vector<FluxJournal::Record>& records){
+    CT_TRACE_SPAN("FluxReplay::replay", "flux");
+    // flux slots are assigned in record order, so a record's slot is the number of FLUX records before it
+    vector<uint32_t> slotOf(records.size(), FluxJournal::NO_REF);
+    fluxFracs.clear();
+    vector<double> current(nOrigins);
+
+    for(size_t r = 0; r < records.size(); ++r){
+        const FluxJournal::Record& rec = records[r];
+        const double* fracs = NULL;
+
+        if(rec.ref != FluxJournal::NO_REF){
+            H_ASSERT(rec.ref < r && slotOf[rec.ref] != FluxJournal::NO_REF, "Journal record refers to an unknown flux");
+            fracs = &fluxFracs[slotOf[rec.ref] * nOrigins];
+        }
+        else if(rec.source != CarbonTracker::LAST){
+            // carbon leaves the source in proportion to what is in it now
+            double total = totals[rec.source];
+            for(int o = 0; o < nOrigins; ++o){
+                current[o] = total == 0 ? 0 : masses[rec.source * nOrigins + o] / total;
+            }
+            fracs = &current[0];
+        }
+
+        switch(rec.op){
+        case FluxJournal::FLUX:
+            H_ASSERT(fracs != NULL, "Journal flux has no source pool");
+            slotOf[r] = fluxFracs.size() / nOrigins;
+            fluxFracs.insert(fluxFracs.end(), fracs, fracs + nOrigins);
+            break;
+        case FluxJournal::ADD:
+            H_ASSERT(fracs != NULL && rec.dest != CarbonTracker::LAST, "Journal addition has no source or destination pool");
+            move(rec.dest, rec.amount, fracs);
+            break;
+        case FluxJournal::SUBTRACT:
+            H_ASSERT(rec.source != CarbonTracker::LAST, "Journal subtraction has no source pool");
+            move(rec.source, -rec.amount, fracs);
+            break;
+        default:
+            H_THROW("Unknown journal record");
+        }
+    }
+}
+
+double FluxReplay::getTotalCarbon(CarbonTracker::Pool pool) const{
+    return totals[pool];
+}
+
+double FluxReplay::getOriginFrac(CarbonTracker::Pool pool, int origin) const{
+    return totals[pool] == 0 ? 0 : masses[pool * nOrigins + origin] / totals[pool];
+}
+
+double FluxReplay::getPoolCarbon(CarbonTracker::Pool pool, int origin) const{
+    return masses[pool * nOrigins + origin];
+}
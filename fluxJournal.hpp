@@ -0,0 +1,179 @@
+#ifndef FLUXJOURNAL_HPP
+#define FLUXJOURNAL_HPP
+#include <fstream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "carbonTracker.hpp"
+
+using namespace std;
+
+  /**
+   * \brief FluxJournal Class: append-only binary log of every carbon transfer made through a CarbonTracker
+   * 
+   * Attach with CarbonTracker::attachJournal - every fluxFromTrackerPool, operator+ and operator- is then written
+   * as one fixed size Record so that the attribution can be recomputed later with FluxReplay without rerunning the model
+   */
+  class FluxJournal{
+   public:
+
+    // Kind of transfer a record describes
+    enum Op {
+      FLUX, ADD, SUBTRACT
+    };
+
+    // One transfer - fixed size so the log can be read back with a single read
+    struct Record {
+      double amount;      // carbon moved (pg C)
+      uint32_t timestep;  // timestep set with setTimestep when the transfer happened
+      uint32_t ref;       // index of the FLUX record the moved carbon was taken with, NO_REF if none
+      uint8_t op;         // Op
+      uint8_t source;     // CarbonTracker::Pool the carbon leaves (LAST if unknown)
+      uint8_t dest;       // CarbonTracker::Pool the carbon enters (LAST if unknown)
+    };
+
+    // marks a record that does not refer back to a flux
+    static const uint32_t NO_REF = 0xFFFFFFFF;
+
+   private:
+
+    // binary log file - truncated on open, so record indices (and refs) start at 0 in the file too
+    ofstream out;
+
+    // records not yet written to out
+    vector<Record> buffer;
+
+    // number of records written by this journal (flushed or not)
+    uint32_t count;
+
+    // current timestep stamped on new records
+    uint32_t timestep;
+
+    // Make the copy constructs private and undefined - only one writer per log file
+    FluxJournal(const FluxJournal&);
+    FluxJournal& operator=(const FluxJournal&);
+
+   public:
+
+    /**
+      * \brief constructor - creates the log file, replacing a log left by an earlier run
+      * \param path file name of the binary log
+      */
+    FluxJournal(const string& path);
+
+    /**
+      * \brief destructor - writes any buffered records
+      */
+    ~FluxJournal();
+
+    /**
+      * \brief sets the timestep stamped on every following record
+      * \param t timestep (e.g. model year or step number)
+      */
+    void setTimestep(uint32_t t);
+
+    /**
+      * \brief appends a record to the log
+      * \param op kind of transfer
+      * \param source pool the carbon leaves
+      * \param dest pool the carbon enters
+      * \param amount carbon moved in pg C
+      * \param ref index of the FLUX record the carbon was taken with (NO_REF if none)
+      * \return index of the new record
+      */
+    uint32_t record(Op op, CarbonTracker::Pool source, CarbonTracker::Pool dest, double amount, uint32_t ref);
+
+    /**
+      * \brief writes all buffered records to the log file
+      */
+    void flush();
+
+    /**
+      * \brief getter for number of records written by this journal
+      * \return record count
+      */
+    uint32_t size() const;
+
+    /**
+      * \brief reads a whole log file back
+      * \param path file name of the binary log
+      * \return vector of all records in the order they were written
+      */
+    static vector<Record> readRecords(const string& path);
+  };
+
+
+  /**
+   * \brief FluxReplay Class: recomputes origin fractions from a FluxJournal under a new origin mapping
+   * 
+   * Pools are seeded with their starting carbon split over any number of new origins and the journal's
+   * transfers are then re-applied as plain linear mixing of origin masses - no physics is rerun.
+   * The origin fractions each flux carries are kept for the whole replay, so a flux may be used in any later step
+   */
+  class FluxReplay{
+   private:
+
+    // number of origins in the new mapping
+    int nOrigins;
+
+    // carbon in each pool by new origin - pool major (LAST x nOrigins)
+    vector<double> masses;
+
+    // total carbon in each pool
+    double totals[CarbonTracker::LAST];
+
+    // origin fractions of the source pool captured at each FLUX record - slot per flux, capacity kept between replays
+    vector<double> fluxFracs;
+
+    /**
+      * \brief removes or adds carbon with the given fractions to a pool
+      */
+    void move(int pool, double amount, const double* fracs);
+
+   public:
+
+    /**
+      * \brief constructor - all pools start empty
+      * \param nOrigins number of origins in the new mapping
+      */
+    FluxReplay(int nOrigins);
+
+    /**
+      * \brief sets the carbon a pool starts with and how it is split over the new origins
+      * \param pool pool to seed
+      * \param totalCarbon starting carbon (pg C)
+      * \param originFracs nOrigins fractions that add up to 1
+      */
+    void setInitialPool(CarbonTracker::Pool pool, double totalCarbon, const double* originFracs);
+
+    /**
+      * \brief re-applies journaled transfers in order
+      * \param records records as returned by FluxJournal::readRecords
+      */
+    void replay(const vector<FluxJournal::Record>& records);
+
+    /**
+      * \brief getter for total carbon in a pool after replay
+      * \param pool pool to query
+      * \return total carbon (pg C)
+      */
+    double getTotalCarbon(CarbonTracker::Pool pool) const;
+
+    /**
+      * \brief getter for fraction of a pool's carbon that came from a new origin
+      * \param pool pool to query
+      * \param origin index of the new origin
+      * \return fraction of the pool's carbon
+      */
+    double getOriginFrac(CarbonTracker::Pool pool, int origin) const;
+
+    /**
+      * \brief getter for amount of a pool's carbon that came from a new origin
+      * \param pool pool to query
+      * \param origin index of the new origin
+      * \return carbon (pg C)
+      */
+    double getPoolCarbon(CarbonTracker::Pool pool, int origin) const;
+  };
+
+#endif
@@ -0,0 +1,92 @@
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include "fluxReduction.hpp"
+#include "tracer.hpp"
+
+using namespace std;
+
+const size_t FluxReduction::LEAF_FLUXES;
+
+void FluxReduction::add(Partial& p, int column, double x, Accumulation acc){
+    double s = p.sum[column];
+    double t = s + x;
+    if(acc == COMPENSATED){
+        // Neumaier - whichever operand is smaller lost its low order bits to t
+        p.comp[column] += fabs(s) >= fabs(x) ? (s - t) + x : (x - t) + s;
+    }
+    p.sum[column] = t;
+}
+
+void FluxReduction::reduceLeaf(const CarbonTracker* fluxes, size_t n, Accumulation acc, Partial& p){
+    memset(&p, 0, sizeof(Partial));
+    for(size_t i = 0; i < n; ++i){
+        const CarbonTracker& flux = fluxes[i];
+        double total = double(flux.totalCarbon);
+        for(int o = 0; o < CarbonTracker::LAST; ++o){
+            add(p, o, flux.originFracs[o] * total, acc);
+        }
+        add(p, CarbonTracker::LAST, flux.untrackedFrac * total, acc);
+        add(p, CarbonTracker::LAST + 1, total, acc);
+    }
+}
+
+CarbonTracker FluxReduction::reduce(const CarbonTracker* fluxes, size_t n, int threads, Accumulation acc){
+    CT_TRACE_SPAN("FluxReduction::reduce", "tracker");
+    H_ASSERT(n > 0, "Nothing to reduce");
+    H_ASSERT(threads >= 1, "Reduction needs at least one thread");
+    size_t nLeaves = (n + LEAF_FLUXES - 1) / LEAF_FLUXES;
+    vector<Partial> partials(nLeaves);
+
+    // threads take contiguous runs of leaves - which thread sums a leaf never changes its value
+    size_t nThreads = (size_t)threads < nLeaves ? (size_t)threads : nLeaves;
+    auto sumLeaves = [&](size_t t){
+        for(size_t l = t * nLeaves / nThreads; l < (t + 1) * nLeaves / nThreads; ++l){
+            size_t first = l * LEAF_FLUXES;
+            reduceLeaf(fluxes + first, n - first < LEAF_FLUXES ? n - first : LEAF_FLUXES, acc, partials[l]);
+        }
+    };
+    vector<thread> workers;
+    for(size_t t = 1; t < nThreads; ++t){
+        workers.push_back(thread(sumLeaves, t));
+    }
+    sumLeaves(0);
+    for(size_t t = 0; t < workers.size(); ++t){
+        workers[t].join();
+    }
+
+    // pairwise tree over the leaves, neighbours first - its shape only depends on n
+    for(size_t width = 1; width < nLeaves; width *= 2){
+        for(size_t l = 0; l + width < nLeaves; l += 2 * width){
+            Partial& left = partials[l];
+            const Partial& right = partials[l + width];
+            for(int c = 0; c < COLUMNS; ++c){
+                add(left, c, right.sum[c], acc);
+                left.comp[c] += right.comp[c];
+            }
+        }
+    }
+
+    const Partial& root = partials[0];
+    double sums[COLUMNS];
+    for(int c = 0; c < COLUMNS; ++c){
+        sums[c] = root.sum[c] + root.comp[c];
+    }
+    double total = sums[CarbonTracker::LAST + 1];
+    double fracs[CarbonTracker::LAST];
+    double untracked;
+    if(total != 0){
+        for(int o = 0; o < CarbonTracker::LAST; ++o){
+            fracs[o] = sums[o] / total;
+        }
+        untracked = sums[CarbonTracker::LAST] / total;
+    }
+    else{
+        // nothing moved - keep the first flux's makeup so the fractions stay valid
+        for(int o = 0; o < CarbonTracker::LAST; ++o){
+            fracs[o] = fluxes[0].originFracs[o];
+        }
+        untracked = fluxes[0].untrackedFrac;
+    }
+    return CarbonTracker(Hector::unitval(total, Hector::U_PGC), fracs, CarbonTracker::LAST, untracked);
+}
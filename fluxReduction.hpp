@@ -0,0 +1,65 @@
+#ifndef FLUXREDUCTION_HPP
+#define FLUXREDUCTION_HPP
+#include <vector>
+#include "carbonTracker.hpp"
+
+using namespace std;
+
+  /**
+   * \brief FluxReduction Class: combines many fluxes (e.g. one per grid cell or sector) into one, in parallel and
+   *        bit for bit the same for any thread count
+   *
+   * The fluxes are cut into leaves of LEAF_FLUXES, each summed in order, and the leaf sums are combined by a
+   * pairwise tree whose shape depends only on the number of fluxes. Threads only decide who sums which leaf,
+   * never the order of any addition, so the result is reproducible. COMPENSATED carries a Neumaier correction
+   * term through the leaves and the tree, so the result is also close to the exactly rounded sum. The combined
+   * flux is a new value, like one built with operator+, but isn't journaled or taped
+   */
+  class FluxReduction{
+   public:
+
+    enum Accumulation {
+      PLAIN,          // ordinary double sums
+      COMPENSATED     // Neumaier compensated sums
+    };
+
+    // fluxes summed in order per leaf of the tree
+    static const size_t LEAF_FLUXES = 256;
+
+   private:
+
+    // origin carbon, untracked carbon, then total carbon
+    static const int COLUMNS = CarbonTracker::LAST + 2;
+
+    // sum of one leaf or subtree - comp is the compensation, 0 for PLAIN
+    struct Partial {
+      double sum[COLUMNS];
+      double comp[COLUMNS];
+    };
+
+    static void add(Partial& p, int column, double x, Accumulation acc);
+
+    /**
+      * \brief sums fluxes [0, n) in order into p
+      */
+    static void reduceLeaf(const CarbonTracker* fluxes, size_t n, Accumulation acc, Partial& p);
+
+   public:
+
+    /**
+      * \brief combines fluxes into one - the same as adding them all up, whatever the thread count
+      * \param fluxes fluxes to combine - at least one
+      * \param n number of fluxes
+      * \param threads threads to sum the leaves on
+      * \param acc how to accumulate
+      * \return flux holding the total carbon of all of them, with their combined origin fractions
+      */
+    static CarbonTracker reduce(const CarbonTracker* fluxes, size_t n, int threads = 1, Accumulation acc = COMPENSATED);
+
+    static CarbonTracker reduce(const vector<CarbonTracker>& fluxes, int threads = 1, Accumulation acc = COMPENSATED){
+        H_ASSERT(!fluxes.empty(), "Nothing to reduce");
+        return reduce(&fluxes[0], fluxes.size(), threads, acc);
+    }
+  };
+
+#endif
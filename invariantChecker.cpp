@@ -0,0 +1,163 @@
+#include <cmath>
+#include <sstream>
+#include "invariantChecker.hpp"
+#include "tracer.hpp"
+
+using namespace std;
+
+extern string POOLNAMES[];
+
+InvariantChecker::InvariantChecker(size_t nPools, size_t capacity, double tolerance)
+    : nPools(nPools), capacity(capacity), tolerance(tolerance), steps(capacity), externals(capacity),
+      homes(capacity * nPools), data(capacity * nPools * WIDTH), head(0), count(0), stopping(false),
+      nChecked(0), nWaits(0), prevMass(NAN){
+    H_ASSERT(nPools > 0 && capacity > 0, "Checker needs pools and room to queue them");
+    failure.kind = NONE;
+    failure.step = 0;
+    failure.pool = -1;
+    worker = thread(&InvariantChecker::run, this);
+}
+
+InvariantChecker::~InvariantChecker(){
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    notEmpty.notify_all();
+    worker.join();
+}
+
+void InvariantChecker::submit(uint64_t step, CarbonTracker* pools, double externalFlux){
+    CT_TRACE_SPAN("InvariantChecker::submit", "check");
+    unique_lock<mutex> guard(lock);
+    if(count == capacity){
+        ++nWaits;
+        notFull.wait(guard, [this](){ return count < capacity; });
+    }
+    // the slot past the queued ones isn't read by the checker until count covers it, so fill it unlocked
+    size_t slot = (head + count) % capacity;
+    guard.unlock();
+    steps[slot] = step;
+    externals[slot] = externalFlux;
+    for(size_t p = 0; p < nPools; ++p){
+        double* d = &data[(slot * nPools + p) * WIDTH];
+        d[0] = double(pools[p].getTotalCarbon());
+        d[1] = pools[p].getUntrackedFrac();
+        double* fracs = pools[p].getOriginFracs();
+        for(int o = 0; o < CarbonTracker::LAST; ++o){
+            d[2 + o] = fracs[o];
+        }
+        homes[slot * nPools + p] = pools[p].getHomePool();
+    }
+    guard.lock();
+    ++count;
+    guard.unlock();
+    notEmpty.notify_one();
+}
+
+void InvariantChecker::run(){
+    unique_lock<mutex> guard(lock);
+    while(true){
+        notEmpty.wait(guard, [this](){ return count > 0 || stopping; });
+        if(count == 0){
+            return;
+        }
+        size_t slot = head;
+        guard.unlock();
+        checkSlot(slot);
+        guard.lock();
+        head = (head + 1) % capacity;
+        --count;
+        ++nChecked;
+        notFull.notify_all();
+    }
+}
+
+void InvariantChecker::fail(Kind kind, uint64_t step, int pool, const string& msg){
+    // only the first failure is kept - later ones usually follow from it
+    if(failure.kind != NONE){
+        return;
+    }
+    lock_guard<mutex> guard(lock);
+    failure.kind = kind;
+    failure.step = step;
+    failure.pool = pool;
+    failure.msg = msg;
+}
+
+void InvariantChecker::checkSlot(size_t slot){
+    uint64_t step = steps[slot];
+    double mass = 0;
+    for(size_t p = 0; p < nPools; ++p){
+        const double* d = &data[(slot * nPools + p) * WIDTH];
+        int home = homes[slot * nPools + p];
+        // context is only formatted for a failure
+        auto where = [&](ostringstream& msg){
+            msg.precision(17);
+            msg << "step " << step << ", pool " << p << " (" << (home == CarbonTracker::LAST ? "unknown" : POOLNAMES[home]) << ")";
+        };
+        mass += d[0];
+        if(d[0] < 0){
+            ostringstream msg;
+            where(msg);
+            msg << ": negative carbon " << d[0] << " Pg C";
+            fail(NEGATIVE_CARBON, step, (int)p, msg.str());
+        }
+        double sum = d[1];
+        for(int o = 0; o < CarbonTracker::LAST + 1; ++o){
+            if(d[1 + o] < -tolerance){
+                ostringstream msg;
+                where(msg);
+                msg << ": negative " << (o == 0 ? "untracked" : POOLNAMES[o - 1]) << " fraction " << d[1 + o];
+                fail(NEGATIVE_FRACTION, step, (int)p, msg.str());
+            }
+            if(o){
+                sum += d[1 + o];
+            }
+        }
+        if(fabs(sum - 1) > tolerance){
+            ostringstream msg;
+            where(msg);
+            msg << ": fractions sum to " << sum;
+            fail(FRACTION_SUM, step, (int)p, msg.str());
+        }
+    }
+    // NAN before the first step, so only later steps are balanced
+    double expected = prevMass + externals[slot];
+    if(fabs(mass - expected) > tolerance * fabs(mass)){
+        ostringstream msg;
+        msg.precision(17);
+        msg << "step " << step << ": total carbon " << mass << " Pg C, expected " << expected << " (previous step "
+            << prevMass << " plus external flux " << externals[slot] << ")";
+        fail(MASS_BALANCE, step, -1, msg.str());
+    }
+    prevMass = mass;
+}
+
+void InvariantChecker::drain(){
+    unique_lock<mutex> guard(lock);
+    notFull.wait(guard, [this](){ return count == 0; });
+}
+
+InvariantChecker::Failure InvariantChecker::firstFailure(){
+    drain();
+    lock_guard<mutex> guard(lock);
+    return failure;
+}
+
+void InvariantChecker::check(){
+    Failure f = firstFailure();
+    if(f.kind != NONE){
+        H_THROW("Invariant failed at " + f.msg);
+    }
+}
+
+uint64_t InvariantChecker::checked(){
+    lock_guard<mutex> guard(lock);
+    return nChecked;
+}
+
+uint64_t InvariantChecker::waits(){
+    lock_guard<mutex> guard(lock);
+    return nWaits;
+}
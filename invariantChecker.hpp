@@ -0,0 +1,133 @@
+#ifndef INVARIANTCHECKER_HPP
+#define INVARIANTCHECKER_HPP
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+#include "carbonTracker.hpp"
+
+using namespace std;
+
+  /**
+   * \brief InvariantChecker Class: checks every step of a run for mass balance, fraction sums and non-negative
+   *        carbon on a thread of its own
+   *
+   * submit copies the pools' totals and fractions into a preallocated slot of a bounded queue and returns - the
+   * main loop only waits if the checker falls a whole queue behind. The checker thread verifies that no pool or
+   * fraction is negative, that each pool's fractions (with the untracked one) sum to 1, and that the carbon of
+   * all the pools changed from the step before by exactly the external flux recorded for the step. The first
+   * failing step is kept with its context; check throws it once the queue has been drained
+   */
+  class InvariantChecker{
+   public:
+
+    // What failed
+    enum Kind {
+      NONE, NEGATIVE_CARBON, NEGATIVE_FRACTION, FRACTION_SUM, MASS_BALANCE
+    };
+
+    // First failure of a run
+    struct Failure {
+      Kind kind;
+      uint64_t step;
+      int pool;           // index in the submitted pools, -1 for mass balance
+      string msg;
+    };
+
+   private:
+    // per pool in a slot - total carbon, untracked fraction, origin fractions
+    static const int WIDTH = CarbonTracker::LAST + 2;
+
+    size_t nPools;
+    size_t capacity;
+    double tolerance;
+
+    // ring of queued snapshots - slot i holds steps[i], externals[i], homes and data at i * nPools (* WIDTH)
+    vector<uint64_t> steps;
+    vector<double> externals;
+    vector<int> homes;
+    vector<double> data;
+    size_t head;          // next slot to check
+    size_t count;         // queued slots
+    bool stopping;
+
+    uint64_t nChecked;
+    uint64_t nWaits;
+    Failure failure;
+
+    // mass of the previous checked step - NAN before the first
+    double prevMass;
+
+    mutex lock;
+    condition_variable notEmpty;
+    condition_variable notFull;
+    thread worker;
+
+    // Make the copy constructs private and undefined - the checker owns a thread
+    InvariantChecker(const InvariantChecker&);
+    InvariantChecker& operator=(const InvariantChecker&);
+
+    void run();
+
+    /**
+      * \brief checks one snapshot - only on the checker thread
+      */
+    void checkSlot(size_t slot);
+
+    void fail(Kind kind, uint64_t step, int pool, const string& msg);
+
+   public:
+
+    /**
+      * \brief constructor - starts the checker thread
+      * \param nPools number of pools in every snapshot
+      * \param capacity snapshots that can wait in the queue
+      * \param tolerance largest error allowed in a fraction sum, and relative to the total mass in the balance
+      */
+    InvariantChecker(size_t nPools, size_t capacity = 256, double tolerance = 1e-10);
+
+    /**
+      * \brief destructor - checks what is queued and stops the thread
+      */
+    ~InvariantChecker();
+
+    /**
+      * \brief queues a snapshot of the pools at the end of a step - waits only if the queue is full. Snapshots
+      *        are checked in the order submitted, so submit from one thread
+      * \param step step number, for the report
+      * \param pools the nPools pools - every carbon pool of the run, so their sum is the whole mass
+      * \param externalFlux carbon that entered (positive) or left (negative) the pools from outside during the
+      *        step, e.g. emissions - 0 for a closed system
+      */
+    void submit(uint64_t step, CarbonTracker* pools, double externalFlux = 0);
+
+    /**
+      * \brief waits until every queued snapshot has been checked
+      */
+    void drain();
+
+    /**
+      * \brief drains the queue, then throws if any step failed
+      */
+    void check();
+
+    /**
+      * \brief drains the queue and reports the first failure
+      * \return failure - kind NONE if every step passed
+      */
+    Failure firstFailure();
+
+    /**
+      * \brief getter for number of snapshots checked so far
+      */
+    uint64_t checked();
+
+    /**
+      * \brief getter for how often submit had to wait for room in the queue
+      */
+    uint64_t waits();
+  };
+
+#endif
@@ -1,6 +1,34 @@
 #include "carbonTracker.hpp"
+#include "fluxJournal.hpp"
+#include "attributionHistory.hpp"
+#include "adjointTape.hpp"
+#include "basicCarbonTracker.hpp"
+#include "dualUnitval.hpp"
+#include "batchUnitval.hpp"
+#include "uncertainty.hpp"
+#include "tracer.hpp"
+#include "trackerStats.hpp"
+#include "compressedHistory.hpp"
+#include "textBuffer.hpp"
+#include "carbonTrackerC.h"
+#include "adaptiveStepper.hpp"
+#include "scenarioState.hpp"
+#include "fluxReduction.hpp"
+#include "fluxAccumulator.hpp"
+#include "invariantChecker.hpp"
+#include "outputPipeline.hpp"
+#include "originHierarchy.hpp"
 #include <iostream>     
 #include <cassert> 
+#include <cmath>
+#include <cstddef>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iterator>
+#include <thread>
 
 using namespace std;
 
@@ -314,6 +342,28 @@ void testFluxFromTrackerPoolWithArray(){
      CarbonTracker::stopTracking();
 }
 
+void testWrongFluxProportionsSum(){
+    cout<<"fluxFromTrackerPool rejects proportions that don't add up to 1"<<endl;
+    Hector::unitval carbon10(10, Hector::U_PGC);
+    double badProportions[] = {0.5, 0.5, 0.5, 0};
+    ValidationStatus status;
+    CarbonTracker::attachStatus(&status);
+    CarbonTracker::startTracking();
+    CarbonTracker soil10(carbon10, CarbonTracker::SOIL);
+    bool raised = false;
+    try{
+        // throws here, or is flagged until the check when validation is deferred
+        soil10.fluxFromTrackerPool(carbon10, badProportions);
+        status.check();
+    }
+    catch(h_exception& e){
+        raised = true;
+    }
+    CarbonTracker::stopTracking();
+    CarbonTracker::attachStatus(NULL);
+    H_ASSERT(raised, "Flux proportions summing to 1.5 were accepted");
+}
+
 void testPrint(){
     CarbonTracker::startTracking();
     Hector::unitval carbon10(10, Hector::U_PGC);
@@ -332,23 +382,1165 @@ void testPrint(){
 
 }
 
+void testJournalReplay(){
+    cout<<"Flux Journal Replay Test"<<endl;
+    const char* path = "journal_test.bin";
+    Hector::unitval carbon10(10, Hector::U_PGC);
+    {
+        // a log left by an earlier run - refs are indices into one run's records, so it must not survive
+        FluxJournal stale(path);
+        stale.record(FluxJournal::FLUX, CarbonTracker::SOIL, CarbonTracker::LAST, 1, FluxJournal::NO_REF);
+        stale.record(FluxJournal::ADD, CarbonTracker::SOIL, CarbonTracker::ATMOSPHERE, 1, 0);
+    }
+    Hector::unitval carbon4(4, Hector::U_PGC);
+    Hector::unitval carbon2(2, Hector::U_PGC);
+    CarbonTracker::startTracking();
+    CarbonTracker soil(carbon10, CarbonTracker::SOIL);
+    CarbonTracker atmos(carbon10, CarbonTracker::ATMOSPHERE);
+    CarbonTracker topOcean(carbon10, CarbonTracker::TOPOCEAN);
+    {
+        FluxJournal journal(path);
+        CarbonTracker::attachJournal(&journal);
+        journal.setTimestep(1);
+        CarbonTracker soilFlux = soil.fluxFromTrackerPool(carbon4);
+        soil = soil - soilFlux;
+        atmos = atmos + soilFlux;
+        journal.setTimestep(2);
+        CarbonTracker atmosFlux = atmos.fluxFromTrackerPool(carbon2);
+        atmos = atmos - atmosFlux;
+        topOcean = topOcean + atmosFlux;
+        CarbonTracker::attachJournal(NULL);
+        H_ASSERT(journal.size() == 6, "Journal doesn't record every transfer");
+    }
+    CarbonTracker::stopTracking();
+
+    vector<FluxJournal::Record> records = FluxJournal::readRecords(path);
+    // the same run always writes the same file - the padding after each record's fields is 0
+    ifstream raw(path, ios::binary);
+    string bytes((istreambuf_iterator<char>(raw)), istreambuf_iterator<char>());
+    raw.close();
+    remove(path);
+    for(size_t r = 0; r < records.size(); ++r){
+        for(size_t b = offsetof(FluxJournal::Record, dest) + 1; b < sizeof(FluxJournal::Record); ++b){
+            H_ASSERT(bytes[r * sizeof(FluxJournal::Record) + b] == 0, "Journal writes uninitialized padding");
+        }
+    }
+    H_ASSERT(records.size() == 6 && records[5].timestep == 2, "Journal doesn't read back");
+
+    // same origins as the run - replay has to reproduce the tracked fractions
+    FluxReplay same(CarbonTracker::LAST);
+    double soilArr[] = {1, 0, 0, 0};
+    double atmosArr[] = {0, 1, 0, 0};
+    double topOceanArr[] = {0, 0, 0, 1};
+    same.setInitialPool(CarbonTracker::SOIL, 10, soilArr);
+    same.setInitialPool(CarbonTracker::ATMOSPHERE, 10, atmosArr);
+    same.setInitialPool(CarbonTracker::TOPOCEAN, 10, topOceanArr);
+    same.replay(records);
+    for(int i = 0; i < CarbonTracker::LAST; ++i){
+        H_ASSERT(fabs(same.getOriginFrac(CarbonTracker::TOPOCEAN, i) - topOcean.getOriginFracs()[i]) < 1e-12, "Replay doesn't match tracked fractions");
+    }
+    H_ASSERT(same.getTotalCarbon(CarbonTracker::TOPOCEAN) == 12, "Replay doesn't move total carbon");
+
+    // new mapping - land (soil) vs everything else
+    FluxReplay remapped(2);
+    double land[] = {1, 0};
+    double other[] = {0, 1};
+    remapped.setInitialPool(CarbonTracker::SOIL, 10, land);
+    remapped.setInitialPool(CarbonTracker::ATMOSPHERE, 10, other);
+    remapped.setInitialPool(CarbonTracker::TOPOCEAN, 10, other);
+    remapped.replay(records);
+    H_ASSERT(fabs(remapped.getPoolCarbon(CarbonTracker::TOPOCEAN, 0) - 2 * 4.0 / 14) < 1e-12, "Replay with new origins is wrong");
+}
+void testAttributionHistory(){
+    cout<<"Attribution History Test"<<endl;
+    CarbonTracker::startTracking();
+    Hector::unitval carbon10(10, Hector::U_PGC);
+    Hector::unitval carbon1(1, Hector::U_PGC);
+    CarbonTracker soil(carbon10, CarbonTracker::SOIL);
+    CarbonTracker atmos(carbon10, CarbonTracker::ATMOSPHERE);
+    AttributionHistory history;
+    for(int year = 1990; year <= 2010; ++year){
+        // soil carbon moves into the atmosphere until 2000, then flows back
+        if(year <= 2000){
+            CarbonTracker flux = soil.fluxFromTrackerPool(carbon1 * 0.5);
+            soil = soil - flux;
+            atmos = atmos + flux;
+        }
+        else{
+            CarbonTracker flux = atmos.fluxFromTrackerPool(carbon1);
+            atmos = atmos - flux;
+            soil = soil + flux;
+        }
+        history.record(year, atmos);
+        history.record(year, soil);
+    }
+    CarbonTracker::stopTracking();
+
+    H_ASSERT(history.size(CarbonTracker::ATMOSPHERE) == 21, "History doesn't record every snapshot");
+    H_ASSERT(history.peakTime(CarbonTracker::ATMOSPHERE, CarbonTracker::SOIL, 1990, 2010) == 2000, "Wrong peak time");
+    H_ASSERT(history.peakTime(CarbonTracker::ATMOSPHERE, CarbonTracker::SOIL, 2003, 2010) == 2003, "Wrong peak time in sub range");
+    H_ASSERT(fabs(history.peakCarbon(CarbonTracker::ATMOSPHERE, CarbonTracker::SOIL, 1990, 2010) - 5.5) < 1e-12, "Wrong peak carbon");
+    H_ASSERT(history.meanFraction(CarbonTracker::ATMOSPHERE, CarbonTracker::ATMOSPHERE, 1990, 1990) == 10 / 10.5, "Wrong single year fraction");
+    double mean = 0;
+    for(int year = 1990; year <= 2000; ++year){
+        mean += (year - 1989) * 0.5 / (10 + (year - 1989) * 0.5);
+    }
+    H_ASSERT(fabs(history.meanFraction(CarbonTracker::ATMOSPHERE, CarbonTracker::SOIL, 1990, 2000) - mean / 11) < 1e-12, "Wrong mean fraction");
+    H_ASSERT(history.carbonFraction(CarbonTracker::SOIL, CarbonTracker::SOIL, 1990, 2000) == 1, "Wrong carbon weighted fraction");
+}
+void testAdjointTape(){
+    cout<<"Adjoint Tape Test"<<endl;
+    Hector::unitval carbon10(10, Hector::U_PGC);
+    Hector::unitval carbon4(4, Hector::U_PGC);
+    Hector::unitval carbon2(2, Hector::U_PGC);
+    CarbonTracker::startTracking();
+    // tiny segments so most of the tape is spilled to the checkpoint file
+    AdjointTape tape("adjoint_test.tmp", 2);
+    CarbonTracker::attachTape(&tape);
+    CarbonTracker soil(carbon10, CarbonTracker::SOIL);
+    CarbonTracker atmos(carbon10, CarbonTracker::ATMOSPHERE);
+    CarbonTracker topOcean(carbon10, CarbonTracker::TOPOCEAN);
+    CarbonTracker soilStart = soil;
+    CarbonTracker soilFlux = soil.fluxFromTrackerPool(carbon4);
+    soil = soil - soilFlux;
+    atmos = atmos + soilFlux;
+    tape.setTimestep(1);
+    CarbonTracker atmosFlux = atmos.fluxFromTrackerPool(carbon2);
+    atmos = atmos - atmosFlux;
+    topOcean = topOcean + 0.5 * atmosFlux;
+    CarbonTracker::attachTape(NULL);
+    CarbonTracker::stopTracking();
+    // leaves spill with their segment too, so neither kind of record piles up in memory
+    H_ASSERT(tape.size() == 5 && tape.entriesInMemory() == 1, "Tape doesn't spill full segments");
+    H_ASSERT(tape.leafCount() == 5 && tape.getLeaves().size() == 5, "Tape doesn't record every leaf");
+
+    tape.reverse(atmos);
+    H_ASSERT(tape.getSensitivity(soilFlux) == 1, "Wrong sensitivity to flux into target");
+    H_ASSERT(tape.getSensitivity(atmosFlux) == -1, "Wrong sensitivity to flux out of target");
+    H_ASSERT(tape.getSensitivity(soilStart) == 0, "Wrong sensitivity to unrelated pool");
+
+    double soilOrigin[] = {1, 0, 0, 0};
+    tape.reverse(topOcean, soilOrigin);
+    H_ASSERT(fabs(tape.getSensitivity(atmosFlux) - 0.5 * 4 / 14) < 1e-12, "Wrong origin weighted sensitivity");
+    H_ASSERT(tape.getSensitivity(soilFlux) == 0, "Sensitivity leaks past recorded fractions");
+
+    // without tracking fluxes carry no fractions - the tape refuses rather than report all 0 sensitivities
+    bool refused = false;
+    try{
+        CarbonTracker::attachTape(&tape);
+    }
+    catch(h_exception& e){
+        refused = true;
+    }
+    H_ASSERT(refused && CarbonTracker::getTape() == NULL, "Tape attached without tracking");
+    vector<AdjointTape::Leaf> leaves = tape.getLeaves();
+    H_ASSERT(leaves[3].sensitivity == 0 && fabs(leaves[4].sensitivity - 0.5 * 4 / 14) < 1e-12, "Spilled sensitivities don't read back");
+}
+// one year of soil respiration and ocean uptake with rates k (soil to atmosphere) and u (atmosphere to top ocean)
+template<class V>
+BasicCarbonTracker<V> laneStep(BasicCarbonTracker<V>& soil, BasicCarbonTracker<V>& atmos, BasicCarbonTracker<V>& topOcean,
+                               const V& k, const V& u){
+    BasicCarbonTracker<V> resp = soil.fluxFromTrackerPool(V(k.lanes() * soil.getTotalCarbon().lanes(), Hector::U_PGC));
+    soil = soil - resp;
+    atmos = atmos + resp;
+    BasicCarbonTracker<V> uptake = atmos.fluxFromTrackerPool(V(u.lanes() * atmos.getTotalCarbon().lanes(), Hector::U_PGC));
+    atmos = atmos - uptake;
+    topOcean = topOcean + uptake;
+    return topOcean;
+}
+
+// the same year on plain CarbonTrackers
+void scalarStep(CarbonTracker& soil, CarbonTracker& atmos, CarbonTracker& topOcean, double k, double u){
+    CarbonTracker resp = soil.fluxFromTrackerPool(k * soil.getTotalCarbon());
+    soil = soil - resp;
+    atmos = atmos + resp;
+    CarbonTracker uptake = atmos.fluxFromTrackerPool(u * atmos.getTotalCarbon());
+    atmos = atmos - uptake;
+    topOcean = topOcean + uptake;
+}
+
+double topOceanSoilCarbon(double k, double u){
+    typedef Hector::dualUnitval<2> D;
+    BasicCarbonTracker<D> soil(D(100, Hector::U_PGC), CarbonTracker::SOIL);
+    BasicCarbonTracker<D> atmos(D(50, Hector::U_PGC), CarbonTracker::ATMOSPHERE);
+    BasicCarbonTracker<D> topOcean(D(80, Hector::U_PGC), CarbonTracker::TOPOCEAN);
+    for(int year = 0; year < 10; ++year){
+        laneStep(soil, atmos, topOcean, D(k, Hector::U_UNITLESS), D(u, Hector::U_UNITLESS));
+    }
+    return topOcean.getPoolCarbon(CarbonTracker::SOIL).value(Hector::U_PGC);
+}
+
+void testDualCarbonTracker(){
+    cout<<"Dual Number Carbon Tracker Test"<<endl;
+    typedef Hector::dualUnitval<2> D;
+    Hector::dual<2> x = Hector::dual<2>::variable(3, 0);
+    Hector::dual<2> y = Hector::dual<2>::variable(4, 1);
+    Hector::dual<2> q = x * y / (x + y);
+    H_ASSERT(fabs(q.d[0] - 16.0 / 49) < 1e-15 && fabs(q.d[1] - 9.0 / 49) < 1e-15, "Dual arithmetic derivatives are wrong");
+
+    CarbonTracker::startTracking();
+    const double k = 0.05, u = 0.2;
+    BasicCarbonTracker<D> soil(D(100, Hector::U_PGC), CarbonTracker::SOIL);
+    BasicCarbonTracker<D> atmos(D(50, Hector::U_PGC), CarbonTracker::ATMOSPHERE);
+    BasicCarbonTracker<D> topOcean(D(80, Hector::U_PGC), CarbonTracker::TOPOCEAN);
+    for(int year = 0; year < 10; ++year){
+        laneStep(soil, atmos, topOcean, D::variable(k, Hector::U_UNITLESS, 0), D::variable(u, Hector::U_UNITLESS, 1));
+    }
+    D soilInOcean = topOcean.getPoolCarbon(CarbonTracker::SOIL);
+
+    // derivatives from one run have to match central differences from four
+    const double h = 1e-6;
+    double dk = (topOceanSoilCarbon(k + h, u) - topOceanSoilCarbon(k - h, u)) / (2 * h);
+    double du = (topOceanSoilCarbon(k, u + h) - topOceanSoilCarbon(k, u - h)) / (2 * h);
+    double plain = topOceanSoilCarbon(k, u);
+    CarbonTracker::stopTracking();
+    H_ASSERT(fabs(soilInOcean.value(Hector::U_PGC) - plain) < 1e-12, "Dual tracker value differs from plain run");
+    H_ASSERT(fabs(soilInOcean.deriv(0) - dk) < 1e-5 * fabs(dk), "Dual tracker derivative wrt k is wrong");
+    H_ASSERT(fabs(soilInOcean.deriv(1) - du) < 1e-5 * fabs(du), "Dual tracker derivative wrt u is wrong");
+}
+void testBatchCarbonTracker(){
+    cout<<"Batched Ensemble Carbon Tracker Test"<<endl;
+    typedef Hector::batchUnitval<4> B;
+    const double soilStart[] = {100, 120, 90, 150};
+    const double rates[] = {0.05, 0.02, 0.08, 0.03};
+    CarbonTracker::startTracking();
+    BasicCarbonTracker<B> soil(B(soilStart, Hector::U_PGC), CarbonTracker::SOIL);
+    BasicCarbonTracker<B> atmos(B(50, Hector::U_PGC), CarbonTracker::ATMOSPHERE);
+    BasicCarbonTracker<B> topOcean(B(80, Hector::U_PGC), CarbonTracker::TOPOCEAN);
+    for(int year = 0; year < 10; ++year){
+        laneStep(soil, atmos, topOcean, B(rates, Hector::U_UNITLESS), B(0.2, Hector::U_UNITLESS));
+    }
+    topOcean = (topOcean * 1.5) / 3 - B(1, Hector::U_PGC);
+
+    // every member has to match its own scalar run bit for bit - both mix with CarbonTracker::mixFracs
+    for(int m = 0; m < 4; ++m){
+        CarbonTracker s(Hector::unitval(soilStart[m], Hector::U_PGC), CarbonTracker::SOIL);
+        CarbonTracker a(Hector::unitval(50, Hector::U_PGC), CarbonTracker::ATMOSPHERE);
+        CarbonTracker t(Hector::unitval(80, Hector::U_PGC), CarbonTracker::TOPOCEAN);
+        for(int year = 0; year < 10; ++year){
+            scalarStep(s, a, t, rates[m], 0.2);
+        }
+        t = t * 1.5;
+        t = t / 3;
+        t = t - Hector::unitval(1, Hector::U_PGC);
+        for(int i = 0; i < CarbonTracker::LAST; ++i){
+            H_ASSERT(topOcean.getOriginFracs()[i].v[m] == t.getOriginFracs()[i], "Batched member fractions differ from scalar run");
+        }
+        // batch division multiplies by the reciprocal, so the totals can differ in the last bit
+        H_ASSERT(fabs(topOcean.getTotalCarbon().value(m, Hector::U_PGC) - t.getTotalCarbon()) < 1e-12, 
+                 "Batched member carbon differs from scalar run");
+    }
+
+    // the same rules as CarbonTracker - deep ocean carbon isn't tracked and the top ocean keeps one origin, with
+    // tracking on and then off every member ends up with its scalar run's fractions and untracked bucket
+    CarbonTracker::setTrackingMask(CarbonTracker::ALL_POOLS, CarbonTracker::ALL_POOLS & ~(1u << CarbonTracker::DEEPOCEAN));
+    CarbonTracker::setTopK(CarbonTracker::TOPOCEAN, 1);
+    for(int tracking = 1; tracking >= 0; --tracking){
+        if(!tracking){
+            CarbonTracker::stopTracking();
+        }
+        BasicCarbonTracker<B> soilB(B(soilStart, Hector::U_PGC), CarbonTracker::SOIL);
+        BasicCarbonTracker<B> deepB(B(60, Hector::U_PGC), CarbonTracker::DEEPOCEAN);
+        BasicCarbonTracker<B> topB(B(80, Hector::U_PGC), CarbonTracker::TOPOCEAN);
+        for(int year = 0; year < 5; ++year){
+            laneStep(soilB, deepB, topB, B(rates, Hector::U_UNITLESS), B(0.5, Hector::U_UNITLESS));
+        }
+        for(int m = 0; m < 4; ++m){
+            CarbonTracker s(Hector::unitval(soilStart[m], Hector::U_PGC), CarbonTracker::SOIL);
+            CarbonTracker d(Hector::unitval(60, Hector::U_PGC), CarbonTracker::DEEPOCEAN);
+            CarbonTracker t(Hector::unitval(80, Hector::U_PGC), CarbonTracker::TOPOCEAN);
+            for(int year = 0; year < 5; ++year){
+                scalarStep(s, d, t, rates[m], 0.5);
+            }
+            for(int i = 0; i < CarbonTracker::LAST; ++i){
+                H_ASSERT(topB.getOriginFracs()[i].v[m] == t.getOriginFracs()[i] && deepB.getOriginFracs()[i].v[m] == d.getOriginFracs()[i], 
+                         "Batched member fractions differ from scalar run under a mask or top-K");
+            }
+            H_ASSERT(topB.getUntrackedFrac().v[m] == t.getUntrackedFrac() && deepB.getUntrackedFrac().v[m] == d.getUntrackedFrac(), 
+                     "Batched member untracked carbon differs from scalar run");
+            H_ASSERT(!tracking || (t.getUntrackedFrac() > 0 && t.getOriginFracs()[CarbonTracker::SOIL] == 0), 
+                     "Mask and top-K weren't applied");
+        }
+    }
+    CarbonTracker::setTrackingMask(CarbonTracker::ALL_POOLS, CarbonTracker::ALL_POOLS);
+    CarbonTracker::setTopK(CarbonTracker::TOPOCEAN, CarbonTracker::LAST);
+
+    // without tracking only a flux can be added to a pool, for both
+    ValidationStatus status;
+    CarbonTracker::attachStatus(&status);
+    int refused = 0;
+    try{
+        // throws here, or is flagged until the check when validation is deferred
+        atmos = atmos + soil;
+        status.check();
+    }
+    catch(h_exception& e){
+        ++refused;
+    }
+    CarbonTracker s(Hector::unitval(100, Hector::U_PGC), CarbonTracker::SOIL);
+    CarbonTracker a(Hector::unitval(50, Hector::U_PGC), CarbonTracker::ATMOSPHERE);
+    try{
+        a = a + s;
+        status.check();
+    }
+    catch(h_exception& e){
+        ++refused;
+    }
+    CarbonTracker::attachStatus(NULL);
+    H_ASSERT(refused == 2, "A pool was added to a pool without tracking");
+}
+void testUncertaintyPropagation(){
+    cout<<"Uncertainty Propagation Test"<<endl;
+    Hector::unitval soilStart(100, Hector::U_PGC, 10);
+    Hector::unitval rate(0.05, Hector::U_UNITLESS, 0.01);
+    H_ASSERT(soilStart.error() == 10 && Hector::unitval(1, Hector::U_PGC).error() == 0, "unitval error isn't kept");
+
+    CarbonTracker::startTracking();
+    typedef Hector::dualUnitval<2> D;
+    BasicCarbonTracker<D> soilD(Hector::linearizedInput<2>(soilStart, 0), CarbonTracker::SOIL);
+    BasicCarbonTracker<D> atmosD(D(50, Hector::U_PGC), CarbonTracker::ATMOSPHERE);
+    BasicCarbonTracker<D> topOceanD(D(80, Hector::U_PGC), CarbonTracker::TOPOCEAN);
+
+    const int SAMPLES = 4096;
+    typedef Hector::batchUnitval<SAMPLES> B;
+    std::mt19937 rng(42);
+    BasicCarbonTracker<B> soilB(Hector::sampledInput<SAMPLES>(soilStart, rng), CarbonTracker::SOIL);
+    BasicCarbonTracker<B> atmosB(B(50, Hector::U_PGC), CarbonTracker::ATMOSPHERE);
+    BasicCarbonTracker<B> topOceanB(B(80, Hector::U_PGC), CarbonTracker::TOPOCEAN);
+    B rateB = Hector::sampledInput<SAMPLES>(rate, rng);
+
+    for(int year = 0; year < 10; ++year){
+        laneStep(soilD, atmosD, topOceanD, Hector::linearizedInput<2>(rate, 1), D(0.2, Hector::U_UNITLESS));
+        laneStep(soilB, atmosB, topOceanB, rateB, B(0.2, Hector::U_UNITLESS));
+    }
+    CarbonTracker::stopTracking();
+
+    // the linearized error and the sample spread have to agree to within sampling noise
+    Hector::unitval linear = Hector::toUnitval(topOceanD.getPoolCarbon(CarbonTracker::SOIL));
+    Hector::unitval sampled = Hector::toUnitval(topOceanB.getPoolCarbon(CarbonTracker::SOIL));
+    H_ASSERT(linear.error() > 0, "No error was propagated");
+    H_ASSERT(fabs(sampled.error() - linear.error()) < 0.1 * linear.error(), "Sampled and linearized errors disagree");
+    H_ASSERT(fabs(sampled - linear) < 0.1 * linear.error(), "Sampled mean drifts from linearized value");
+}
+
+void testTrackingMask(){
+    cout<<"Tracking Mask Test"<<endl;
+    // keep fractions for soil and atmosphere only, and only soil and atmosphere carbon gets its own fraction
+    CarbonTracker::setTrackingMask((1u << CarbonTracker::SOIL) | (1u << CarbonTracker::ATMOSPHERE),
+                                   (1u << CarbonTracker::SOIL) | (1u << CarbonTracker::ATMOSPHERE));
+    CarbonTracker::startTracking();
+    CarbonTracker soil(Hector::unitval(100, Hector::U_PGC), CarbonTracker::SOIL);
+    CarbonTracker atmos(Hector::unitval(50, Hector::U_PGC), CarbonTracker::ATMOSPHERE);
+    CarbonTracker deepOcean(Hector::unitval(30, Hector::U_PGC), CarbonTracker::DEEPOCEAN);
+    CarbonTracker topOcean(Hector::unitval(80, Hector::U_PGC), CarbonTracker::TOPOCEAN);
+    H_ASSERT(deepOcean.getUntrackedFrac() == 1 && topOcean.getUntrackedFrac() == 1, "Masked carbon isn't untracked");
+
+    CarbonTracker soilFlux = soil.fluxFromTrackerPool(Hector::unitval(10, Hector::U_PGC));
+    atmos = atmos + soilFlux;
+    soil = soil - soilFlux;
+    CarbonTracker atmosFlux = atmos.fluxFromTrackerPool(Hector::unitval(6, Hector::U_PGC));
+    deepOcean = deepOcean + atmosFlux;
+    atmos = atmos - atmosFlux;
+    CarbonTracker topFlux = topOcean.fluxFromTrackerPool(Hector::unitval(20, Hector::U_PGC));
+    atmos = atmos + topFlux;
+    topOcean = topOcean - topFlux;
+    CarbonTracker::stopTracking();
+    CarbonTracker::setTrackingMask(CarbonTracker::ALL_POOLS, CarbonTracker::ALL_POOLS);
+
+    H_ASSERT(fabs(atmos.getPoolCarbon(CarbonTracker::SOIL) - 9) < 1e-9, "Tracked origin mixed wrong");
+    H_ASSERT(fabs(atmos.getPoolCarbon(CarbonTracker::ATMOSPHERE) - 45) < 1e-9, "Tracked origin mixed wrong");
+    H_ASSERT(fabs(atmos.getUntrackedCarbon() - 20) < 1e-9, "Untracked origin wasn't bucketed");
+    // the untracked pool only changes its total
+    H_ASSERT(deepOcean.getTotalCarbon() == 36 && deepOcean.getUntrackedFrac() == 1 && 
+             deepOcean.getPoolCarbon(CarbonTracker::ATMOSPHERE) == 0, "Untracked pool kept fractions");
+}
+
+void testTopKTracking(){
+    cout<<"Top-K Tracking Test"<<endl;
+    CarbonTracker::setTopK(CarbonTracker::ATMOSPHERE, 1);
+    CarbonTracker::startTracking();
+    CarbonTracker soil(Hector::unitval(100, Hector::U_PGC), CarbonTracker::SOIL);
+    CarbonTracker atmos(Hector::unitval(50, Hector::U_PGC), CarbonTracker::ATMOSPHERE);
+    CarbonTracker topOcean(Hector::unitval(80, Hector::U_PGC), CarbonTracker::TOPOCEAN);
+    atmos = atmos + soil.fluxFromTrackerPool(Hector::unitval(10, Hector::U_PGC));
+    H_ASSERT(atmos.getPoolCarbon(CarbonTracker::SOIL) == 0 && fabs(atmos.getAttributionErrorBound() - 10) < 1e-9, 
+             "Smallest origin wasn't folded");
+    atmos = atmos + topOcean.fluxFromTrackerPool(Hector::unitval(30, Hector::U_PGC));
+    CarbonTracker::stopTracking();
+    CarbonTracker::setTopK(CarbonTracker::ATMOSPHERE, CarbonTracker::LAST);
+
+    H_ASSERT(fabs(atmos.getPoolCarbon(CarbonTracker::ATMOSPHERE) - 50) < 1e-9, "Largest origin wasn't kept");
+    H_ASSERT(atmos.getPoolCarbon(CarbonTracker::TOPOCEAN) == 0, "Pool keeps more than K origins");
+    // the folded soil and top ocean carbon are both inside the bound
+    H_ASSERT(fabs(atmos.getAttributionErrorBound() - 40) < 1e-9, "Wrong error bound");
+}
+
+void testReplayAcrossSteps(){
+    cout<<"Replay Across Steps Test"<<endl;
+    const int ORIGINS = 2000;
+    // a journaled flux may be used steps after it was taken - replay keeps its fractions for the whole run
+    vector<FluxJournal::Record> records;
+    for(uint32_t step = 0; step < 50; ++step){
+        uint32_t ref = (uint32_t)records.size();
+        FluxJournal::Record flux = {1, step, FluxJournal::NO_REF, FluxJournal::FLUX, CarbonTracker::SOIL, CarbonTracker::LAST};
+        FluxJournal::Record sub = {1, step, ref, FluxJournal::SUBTRACT, CarbonTracker::SOIL, CarbonTracker::ATMOSPHERE};
+        FluxJournal::Record add = {1, step + 1, ref, FluxJournal::ADD, CarbonTracker::SOIL, CarbonTracker::ATMOSPHERE};
+        records.push_back(flux);
+        records.push_back(sub);
+        records.push_back(add);
+    }
+    vector<double> soilFracs(ORIGINS, 1.0 / ORIGINS);
+    FluxReplay replay(ORIGINS);
+    replay.setInitialPool(CarbonTracker::SOIL, 1000, &soilFracs[0]);
+    replay.replay(records);
+    H_ASSERT(replay.getTotalCarbon(CarbonTracker::ATMOSPHERE) == 50 && 
+             fabs(replay.getPoolCarbon(CarbonTracker::ATMOSPHERE, 7) - 50.0 / ORIGINS) < 1e-12, "Replay across steps is wrong");
+}
+
+void testTransfer(){
+    cout<<"Fused Transfer Test"<<endl;
+    Hector::unitval carbon100(100, Hector::U_PGC);
+    Hector::unitval carbon50(50, Hector::U_PGC);
+    Hector::unitval carbon10(10, Hector::U_PGC);
+    Hector::unitval carbon5(5, Hector::U_PGC);
+    double isotopeArr[] = {0.5, 0.5, 0, 0};
+    CarbonTracker::startTracking();
+    CarbonTracker soil(carbon100, CarbonTracker::SOIL);
+    CarbonTracker atmos(carbon50, CarbonTracker::ATMOSPHERE);
+    CarbonTracker soilFused = soil;
+    CarbonTracker atmosFused = atmos;
+
+    CarbonTracker flux = soil.fluxFromTrackerPool(carbon10);
+    soil = soil - flux;
+    atmos = atmos + flux;
+    CarbonTracker back = atmos.fluxFromTrackerPool(carbon5, isotopeArr);
+    atmos = atmos - back;
+    soil = soil + back;
+    CarbonTracker::transfer(soilFused, atmosFused, carbon10);
+    CarbonTracker::transfer(atmosFused, soilFused, carbon5, isotopeArr);
+    CarbonTracker::stopTracking();
+
+    for(int i = 0; i < CarbonTracker::LAST; ++i){
+        H_ASSERT(fabs(soilFused.getOriginFracs()[i] - soil.getOriginFracs()[i]) < 1e-12, "Transfer doesn't match separate flux steps");
+        H_ASSERT(fabs(atmosFused.getOriginFracs()[i] - atmos.getOriginFracs()[i]) < 1e-12, "Transfer doesn't match separate flux steps");
+    }
+    H_ASSERT(soilFused.getTotalCarbon() == 95 && atmosFused.getTotalCarbon() == 55, "Transfer doesn't conserve carbon");
+
+    // not tracking - only the totals move
+    CarbonTracker::transfer(soilFused, atmosFused, carbon5);
+    H_ASSERT(soilFused.getTotalCarbon() == 90 && atmosFused.getOriginFracs()[CarbonTracker::SOIL] == atmos.getOriginFracs()[CarbonTracker::SOIL], 
+             "Transfer changes fractions when not tracking");
+}
+
+void testValidationStatus(){
+    cout<<"Deferred Validation Status Test"<<endl;
+    ValidationStatus status;
+    H_ASSERT(status.status() == 0, "New status isn't clean");
+    status.check();     // nothing flagged - must not throw
+    for(int i = 0; i < 20; ++i){
+        status.flag(i == 19 ? ValidationStatus::DIVIDE_BY_ZERO : ValidationStatus::WRONG_UNITS, "test violation", __func__, __FILE__, i);
+    }
+    H_ASSERT(status.status() == (ValidationStatus::WRONG_UNITS | ValidationStatus::DIVIDE_BY_ZERO) && status.violations() == 20,
+             "Status word doesn't collect flags");
+    // the ring keeps the most recent diagnostics, oldest first
+    H_ASSERT(status.diagnostics() == ValidationStatus::RING_SIZE && status.diagnostic(0).line == 4 && 
+             status.diagnostic(ValidationStatus::RING_SIZE - 1).flag == ValidationStatus::DIVIDE_BY_ZERO, "Diagnostic ring is wrong");
+
+    bool raised = false;
+    try{
+        status.check();
+    }
+    catch(h_exception& e){
+        raised = true;
+    }
+    H_ASSERT(raised && status.status() == 0 && status.violations() == 0, "Check doesn't raise and clear");
+
+    // the tracker flags into whichever status is attached
+    CarbonTracker::attachStatus(&status);
+    H_ASSERT(&CarbonTracker::getStatus() == &status, "Status isn't attached");
+    CarbonTracker::attachStatus(NULL);
+    H_ASSERT(&CarbonTracker::getStatus() != &status, "Status isn't detached");
+}
+
+void testTracer(){
+    cout<<"Tracer Test"<<endl;
+    const char* path = "trace_test.json";
+    Tracer::clear();
+    {
+        TraceSpan span("test span", "test");
+        Tracer::counter("test counter", 3);
+    }
+    std::thread worker([](){
+        TraceSpan span("worker span", "test");
+    });
+    worker.join();
+    H_ASSERT(Tracer::size() == 3 && Tracer::dropped() == 0, "Tracer doesn't keep every thread's events");
+
+    Tracer::write(path);
+    ifstream in(path);
+    string json((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+    in.close();
+    remove(path);
+    H_ASSERT(json.find("{\"traceEvents\":[") == 0 && json.find("\"name\":\"worker span\"") != string::npos &&
+             json.find("\"ph\":\"C\"") != string::npos && json.find("\"args\":{\"value\":3}") != string::npos, 
+             "Trace isn't Chrome trace event JSON");
+    Tracer::clear();
+    H_ASSERT(Tracer::size() == 0, "Tracer doesn't clear");
+
+    // writing while another thread records - only finished events are read
+    std::atomic<bool> done(false);
+    std::thread recorder([&done](){
+        for(int i = 0; i < 20000; ++i){
+            Tracer::counter("busy counter", i);
+        }
+        done = true;
+    });
+    while(!done){
+        Tracer::write(path);
+    }
+    recorder.join();
+    remove(path);
+    H_ASSERT(Tracer::size() == 20000, "Tracer loses events written while recording");
+
+    // threads that come and go take over the buffers of finished ones, events included
+    size_t buffers = Tracer::buffers();
+    for(int t = 0; t < 100; ++t){
+        std::thread([](){
+            TraceSpan span("short thread span", "test");
+        }).join();
+    }
+    H_ASSERT(Tracer::buffers() == buffers && Tracer::size() == 20100, "Finished threads' buffers aren't reused");
+    Tracer::clear();
+}
+
+void testTrackerStats(){
+    cout<<"Tracker Stats Test"<<endl;
+    TrackerStats::reset();
+    TrackerStats::countOp(TrackerStats::FLUX);
+    TrackerStats::countOp(TrackerStats::ADD);
+    TrackerStats::countMoved(CarbonTracker::SOIL, CarbonTracker::ATMOSPHERE, 4);
+    TrackerStats::noteDrift(1e-14);
+    std::thread worker([](){
+        TrackerStats::countOp(TrackerStats::ADD);
+        TrackerStats::countMoved(CarbonTracker::SOIL, CarbonTracker::ATMOSPHERE, 2);
+        TrackerStats::countCheckFailure(ValidationStatus::WRONG_UNITS);
+        TrackerStats::noteDrift(1e-12);
+    });
+    worker.join();
 
+    // each thread counts into its own slot - collect adds them up
+    TrackerStats::Counts totals = TrackerStats::collect();
+    H_ASSERT(totals.ops[TrackerStats::ADD] == 2 && totals.ops[TrackerStats::FLUX] == 1 && 
+             totals.moved[CarbonTracker::SOIL][CarbonTracker::ATMOSPHERE] == 6, "Stats don't add up over threads");
+    H_ASSERT(totals.unitFailures == 1 && totals.checkFailures == 1 && totals.maxDrift == 1e-12, "Stats lose failures or drift");
+    string json = TrackerStats::toJson();
+    H_ASSERT(json.find("\"add\":2") != string::npos && 
+             json.find("{\"from\":\"Soil\",\"to\":\"Atmosphere\",\"pgc\":6}") != string::npos, "Stats JSON is wrong");
+    TrackerStats::reset();
+    H_ASSERT(TrackerStats::collect().ops[TrackerStats::ADD] == 0, "Stats don't reset");
 
+    // collecting while another thread counts - totals only ever grow and end up exact
+    std::atomic<bool> done(false);
+    std::thread counter([&done](){
+        for(int i = 0; i < 100000; ++i){
+            TrackerStats::countOp(TrackerStats::TRANSFER);
+        }
+        done = true;
+    });
+    uint64_t seen = 0;
+    while(!done){
+        uint64_t now = TrackerStats::collect().ops[TrackerStats::TRANSFER];
+        H_ASSERT(now >= seen, "Stats went backwards while counting");
+        seen = now;
+    }
+    counter.join();
+    H_ASSERT(TrackerStats::collect().ops[TrackerStats::TRANSFER] == 100000, "Stats lost counts while collecting");
+
+    // threads that come and go leave their counts behind and hand their slot to the next thread
+    size_t slots = TrackerStats::slots();
+    for(int t = 0; t < 100; ++t){
+        std::thread([](){
+            TrackerStats::countOp(TrackerStats::MULTIPLY);
+        }).join();
+    }
+    totals = TrackerStats::collect();
+    H_ASSERT(TrackerStats::slots() == slots && totals.ops[TrackerStats::MULTIPLY] == 100 && totals.ops[TrackerStats::TRANSFER] == 100000, 
+             "Finished threads' slots aren't reused");
+    TrackerStats::reset();
+    H_ASSERT(TrackerStats::collect().ops[TrackerStats::TRANSFER] == 0, "Stats don't reset finished threads' counts");
+}
+
+void testCompressedHistory(){
+    cout<<"Compressed History Test"<<endl;
+    const char* path = "compressedHistoryTest.bin";
+    CompressedHistory memory(32);
+    CompressedHistory streamed(path, 32);
+    vector<CompressedHistory::Snapshot> expected;
+    CarbonTracker::startTracking();
+    CarbonTracker soil(Hector::unitval(1000, Hector::U_PGC), CarbonTracker::SOIL);
+    CarbonTracker atmos(Hector::unitval(600, Hector::U_PGC), CarbonTracker::ATMOSPHERE);
+    // ten years of monthly snapshots - crosses several blocks
+    for(int month = 0; month < 120; ++month){
+        double time = 1900 + month / 12.0;
+        CarbonTracker flux = soil.fluxFromTrackerPool(Hector::unitval(0.5, Hector::U_PGC));
+        atmos = atmos + flux;
+        soil = soil - flux;
+        memory.record(time, atmos);
+        memory.record(time, soil);
+        streamed.record(time, atmos);
+        CompressedHistory::Snapshot s = {time, atmos.getTotalCarbon().value(Hector::U_PGC), {0}, atmos.getUntrackedFrac()};
+        for(int o = 0; o < CarbonTracker::LAST; ++o){
+            s.originFracs[o] = atmos.getOriginFracs()[o];
+        }
+        expected.push_back(s);
+    }
+    CarbonTracker::stopTracking();
+
+    vector<CompressedHistory::Snapshot> all = memory.query(CarbonTracker::ATMOSPHERE, 0, 3000);
+    H_ASSERT(all.size() == expected.size() && memory.size(CarbonTracker::SOIL) == 120, "History lost snapshots");
+    for(size_t i = 0; i < all.size(); ++i){
+        H_ASSERT(all[i].time == expected[i].time && all[i].totalCarbon == expected[i].totalCarbon && 
+                 sameCTArrays(all[i].originFracs, expected[i].originFracs) && all[i].untrackedFrac == expected[i].untrackedFrac, 
+                 "History doesn't round trip exactly");
+    }
+    // a range that starts and ends inside blocks, then the same from the file
+    vector<CompressedHistory::Snapshot> range = memory.query(CarbonTracker::ATMOSPHERE, expected[20].time, expected[70].time);
+    vector<CompressedHistory::Snapshot> fromFile = streamed.query(CarbonTracker::ATMOSPHERE, expected[20].time, expected[70].time);
+    H_ASSERT(range.size() == 51 && range.front().time == expected[20].time && range.back().totalCarbon == expected[70].totalCarbon, 
+             "History range query is wrong");
+    H_ASSERT(fromFile.size() == 51 && sameCTArrays(fromFile[30].originFracs, expected[50].originFracs), "Streamed history is wrong");
+    H_ASSERT(streamed.query(CarbonTracker::SOIL, 0, 3000).empty(), "History mixes pools");
+
+    cout << "History compression " << memory.rawBytes() << " -> " << memory.compressedBytes() << " bytes" << endl;
+    H_ASSERT(memory.compressedBytes() * 4 < memory.rawBytes(), "History doesn't compress");
+    remove(path);
+}
+
+void testTextBuffer(){
+    cout<<"Text Buffer Test"<<endl;
+    char text[TextBuffer::DOUBLE_CHARS];
+    double values[] = {10, -0.0, 0.1, 1.0 / 3, 2.5e-300, -1e20, 123456789.125};
+    const char* expected[] = {"10", "-0", "0.1", "0.3333333333333333", "2.5e-300", "-1e+20", "123456789.125"};
+    for(int i = 0; i < 7; ++i){
+        string s(text, TextBuffer::formatDouble(text, values[i]));
+        H_ASSERT(s == expected[i] && strtod(s.c_str(), NULL) == values[i], "Double isn't written shortest round trip");
+    }
+    H_ASSERT(string(Hector::unitval::unitsNameCStr(Hector::U_PGC)) == "Pg C" && 
+             Hector::unitval::unitsName(Hector::U_YRS) == "Years", "Wrong units name");
+
+    Hector::unitval carbon10(10, Hector::U_PGC);
+    Hector::unitval carbon3(3, Hector::U_PGC);
+    CarbonTracker::startTracking();
+    CarbonTracker soil(carbon10, CarbonTracker::SOIL);
+    CarbonTracker atmos(carbon10, CarbonTracker::ATMOSPHERE);
+    atmos = atmos + soil.fluxFromTrackerPool(carbon3);
+    CarbonTracker::stopTracking();
+    TextBuffer buffer(16);
+    buffer.append(carbon10).append('\n').append(atmos);
+    H_ASSERT(buffer.str() == "10 Pg C\nSoil: 3 Pg C \nAtmosphere: 10 Pg C \nDeep Ocean: 0 Pg C \nTop Ocean: 0 Pg C \n", 
+             "Snapshot text is wrong");
+    // the stream operators write the same layout, and keep the stream's own precision and width
+    ostringstream out;
+    out << carbon10 << '\n' << atmos;
+    H_ASSERT(out.str() == buffer.str(), "Stream operators don't match the buffer");
+    ostringstream formatted;
+    formatted << setprecision(3) << Hector::unitval(1.0 / 3, Hector::U_PGC) << ',' << setw(4) << carbon3;
+    H_ASSERT(formatted.str() == "0.333 Pg C,   3 Pg C", "Stream operators ignore the stream's format");
+
+    // once grown, a cleared buffer takes every later snapshot without growing again
+    size_t capacity = buffer.capacity();
+    for(int i = 0; i < 100; ++i){
+        buffer.clear();
+        buffer.append(carbon10).append('\n').append(atmos);
+    }
+    H_ASSERT(buffer.capacity() == capacity, "Buffer grows in steady state");
+}
+
+void testCABI(){
+    cout<<"C ABI Test"<<endl;
+    H_ASSERT(ct_abi_version() == CT_ABI_VERSION, "Wrong ABI version");
+    H_ASSERT(ct_start_tracking() == CT_OK, ct_last_error());
+    ct_tracker* pools[] = {ct_create(100, CT_SOIL), ct_create(50, CT_ATMOSPHERE), ct_create(30, CT_DEEPOCEAN)};
+    // soil -> atmosphere -> deep ocean, three steps in one call
+    int src[] = {0, 1};
+    int dst[] = {1, 2};
+    double amounts[] = {10, 5, 10, 5, 10, 5};
+    double totals[9];
+    H_ASSERT(ct_step(pools, 3, src, dst, 2, amounts, 3, totals) == CT_OK, ct_last_error());
+    H_ASSERT(totals[0] == 90 && totals[1] == 55 && totals[2] == 35 && totals[6] == 70 && totals[8] == 45, 
+             "Batched steps are wrong");
+    ct_tracker* back[] = {pools[2]};
+    ct_tracker* to[] = {pools[0]};
+    double amount = 1;
+    H_ASSERT(ct_apply_fluxes(back, to, &amount, 1) == CT_OK, ct_last_error());
+    ct_stop_tracking();
+
+    double fracs[3 * CT_N_POOLS];
+    double untracked[3];
+    H_ASSERT(ct_read_fractions(pools, 3, fracs, untracked) == CT_OK, ct_last_error());
+    CarbonTracker::startTracking();
+    CarbonTracker soil(Hector::unitval(100, Hector::U_PGC), CarbonTracker::SOIL);
+    CarbonTracker atmos(Hector::unitval(50, Hector::U_PGC), CarbonTracker::ATMOSPHERE);
+    CarbonTracker deepOcean(Hector::unitval(30, Hector::U_PGC), CarbonTracker::DEEPOCEAN);
+    for(int step = 0; step < 3; ++step){
+        CarbonTracker::transfer(soil, atmos, Hector::unitval(10, Hector::U_PGC));
+        CarbonTracker::transfer(atmos, deepOcean, Hector::unitval(5, Hector::U_PGC));
+    }
+    CarbonTracker::transfer(deepOcean, soil, Hector::unitval(1, Hector::U_PGC));
+    CarbonTracker::stopTracking();
+    H_ASSERT(sameCTArrays(fracs, soil.getOriginFracs()) && sameCTArrays(fracs + CT_N_POOLS, atmos.getOriginFracs()) && 
+             sameCTArrays(fracs + 2 * CT_N_POOLS, deepOcean.getOriginFracs()), "C ABI fractions differ from C++");
+    H_ASSERT(untracked[0] == soil.getUntrackedFrac() && untracked[2] == deepOcean.getUntrackedFrac(), 
+             "C ABI untracked fractions differ from C++");
+    H_ASSERT(ct_read_fractions(pools, 3, fracs, NULL) == CT_OK, "Untracked fractions can't be skipped");
+
+    // errors come back as codes, never as exceptions
+    int bad[] = {0, 3};
+    H_ASSERT(ct_step(pools, 3, bad, dst, 2, amounts, 1, NULL) == CT_ERROR && 
+             string(ct_last_error()).find("Flux pool index out of range") != string::npos, "Bad index wasn't reported");
+    H_ASSERT(ct_create(1, CT_N_POOLS) == NULL, "Bad pool wasn't reported");
+    for(int p = 0; p < 3; ++p){
+        ct_destroy(pools[p]);
+    }
+}
+
+void testAdaptiveStepper(){
+    cout<<"Adaptive Sub-stepping Test"<<endl;
+    CarbonTracker::startTracking();
+    CarbonTracker pools[] = {CarbonTracker(Hector::unitval(100, Hector::U_PGC), CarbonTracker::SOIL),
+                             CarbonTracker(Hector::unitval(50, Hector::U_PGC), CarbonTracker::ATMOSPHERE)};
+    AdaptiveStepper stepper(0.5, 1e-2);
+    stepper.addFlux(0, 1, 0.1);
+    // a gentle step is a single plain transfer
+    H_ASSERT(stepper.step(pools, 2, 1) == 1 && pools[0].getTotalCarbon() == 90 && pools[1].getTotalCarbon() == 60, 
+             "Non-stiff step was refined");
+
+    // a step that would take 5 times the soil's carbon in one go - refined instead of overdrawn
+    stepper.setRate(0, 5);
+    int substeps = stepper.step(pools, 2, 1);
+    CarbonTracker::stopTracking();
+    double soil = pools[0].getTotalCarbon().value(Hector::U_PGC);
+    H_ASSERT(substeps > 10 && stepper.refinedSteps() == 1 && stepper.substeps() == 1 + (uint64_t)substeps, 
+             "Stiff step wasn't refined");
+    H_ASSERT(soil > 0 && fabs(soil - 90 * exp(-5.0)) < 0.01 * 90 * exp(-5.0), "Refined step is inaccurate");
+    H_ASSERT(fabs(soil + pools[1].getTotalCarbon().value(Hector::U_PGC) - 150) < 1e-9, "Sub-stepping lost carbon");
+    // the atmosphere holds its own 50 plus everything the soil lost
+    H_ASSERT(fabs(pools[1].getPoolCarbon(CarbonTracker::ATMOSPHERE) - 50) < 1e-9 && 
+             fabs(pools[1].getPoolCarbon(CarbonTracker::SOIL) - (100 - soil)) < 1e-9, "Sub-stepping mixed origins wrong");
+
+    // too few sub-steps allowed to reach the tolerance - 10, 20 and 40 never agree to 1e-12
+    AdaptiveStepper capped(0.5, 1e-12, 40);
+    capped.addFlux(0, 1, 5);
+    ValidationStatus status;
+    CarbonTracker::attachStatus(&status);
+    CarbonTracker::startTracking();
+    bool raised = false;
+    try{
+        // throws here, or is applied and flagged until the check when validation is deferred
+        capped.step(pools, 2, 1);
+        status.check();
+    }
+    catch(h_exception& e){
+        raised = true;
+    }
+    CarbonTracker::stopTracking();
+    CarbonTracker::attachStatus(NULL);
+    H_ASSERT(raised && capped.unconvergedSteps() == 1, "Step that hit maxSubsteps wasn't reported");
+    H_ASSERT(fabs(pools[0].getTotalCarbon().value(Hector::U_PGC) + pools[1].getTotalCarbon().value(Hector::U_PGC) - 150) < 1e-9, 
+             "Unconverged step lost carbon");
+}
+
+void testExchange(){
+    cout<<"Implicit Exchange Test"<<endl;
+    const double kab = 2, kba = 0.5;
+    CarbonTracker::startTracking();
+    CarbonTracker top(Hector::unitval(100, Hector::U_PGC), CarbonTracker::TOPOCEAN);
+    CarbonTracker deep(Hector::unitval(400, Hector::U_PGC), CarbonTracker::DEEPOCEAN);
+    // explicit reference at 1/1000 year
+    CarbonTracker topRef(top);
+    CarbonTracker deepRef(deep);
+    for(int step = 0; step < 10000; ++step){
+        double down = kab * topRef.getTotalCarbon().value(Hector::U_PGC) * 0.001;
+        double up = kba * deepRef.getTotalCarbon().value(Hector::U_PGC) * 0.001;
+        CarbonTracker::transfer(topRef, deepRef, Hector::unitval(down, Hector::U_PGC));
+        CarbonTracker::transfer(deepRef, topRef, Hector::unitval(up, Hector::U_PGC));
+    }
+    // annual steps, with rates that take several times a pool per year explicitly
+    for(int year = 0; year < 10; ++year){
+        CarbonTracker::exchange(top, deep, kab, kba, 1);
+    }
+    CarbonTracker::stopTracking();
+
+    // exact: top relaxes to kba / (kab + kba) of the 500
+    double exact = 100 + (100 - 0.2 * 500) * exp(-25.0);
+    H_ASSERT(fabs(top.getTotalCarbon().value(Hector::U_PGC) - exact) < 1e-9 && 
+             fabs(top.getTotalCarbon().value(Hector::U_PGC) + deep.getTotalCarbon().value(Hector::U_PGC) - 500) < 1e-9, 
+             "Exchange totals are wrong");
+    // and so does each origin - the top ocean's own 100 relaxes to a 20 / 80 split
+    double exactOwn = 20 + 80 * exp(-25.0);
+    H_ASSERT(fabs(top.getPoolCarbon(CarbonTracker::TOPOCEAN) - exactOwn) < 1e-9 && 
+             fabs(deep.getPoolCarbon(CarbonTracker::TOPOCEAN) - (100 - exactOwn)) < 1e-9, "Exchange fractions are wrong");
+    for(int i = 0; i < CarbonTracker::LAST; ++i){
+        H_ASSERT(fabs(top.getOriginFracs()[i] - topRef.getOriginFracs()[i]) < 1e-3, "Exchange disagrees with small explicit steps");
+    }
+
+    // a negative rate is refused like any other tracker check - raised now, or at the check when deferred
+    ValidationStatus status;
+    CarbonTracker::attachStatus(&status);
+    Hector::unitval topBefore = top.getTotalCarbon();
+    bool raised = false;
+    try{
+        CarbonTracker::exchange(top, deep, -1, 0.1, 1);
+        status.check();
+    }
+    catch(h_exception& e){
+        raised = true;
+    }
+    CarbonTracker::attachStatus(NULL);
+    H_ASSERT(raised && top.getTotalCarbon() == topBefore, "Negative exchange rate was accepted");
+}
+
+void testScenarioFork(){
+    cout<<"Scenario Fork Test"<<endl;
+    CarbonTracker::startTracking();
+    ScenarioState base;
+    for(int i = 0; i < 1024; ++i){
+        base.add(CarbonTracker(Hector::unitval(100 + i, Hector::U_PGC), (CarbonTracker::Pool)(i % CarbonTracker::LAST)));
+    }
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    vector<ScenarioState> branches;
+    branches.reserve(1000);
+    for(int b = 0; b < 1000; ++b){
+        branches.push_back(base.fork());
+    }
+    double forkMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    H_ASSERT(branches[999].ownedBlocks() == 0, "Forking copied pools");
+
+    // each branch moves a different amount between two pools in the first block
+    for(size_t b = 0; b < branches.size(); ++b){
+        CarbonTracker from = branches[b].get(0), to = branches[b].get(1);
+        CarbonTracker::transfer(from, to, Hector::unitval(b * 0.01, Hector::U_PGC));
+        branches[b].modify(0) = from;
+        branches[b].modify(1) = to;
+    }
+    CarbonTracker::stopTracking();
+    cout << "Forked 1000 scenarios of " << base.size() << " pools in " << forkMs << " ms" << endl;
+
+    // only the written block was copied, once per branch - the rest is still shared by everyone
+    H_ASSERT(branches[7].ownedBlocks() == 1 && base.ownedBlocks() == 0 && base.blockCount() == 1024 / ScenarioState::BLOCK_POOLS, 
+             "Branches copied more than they wrote");
+    H_ASSERT(base.get(0).getTotalCarbon() == 100 && base.get(1).getTotalCarbon() == 101, "Branch writes leaked into the base");
+    H_ASSERT(fabs(branches[500].get(0).getTotalCarbon().value(Hector::U_PGC) - 95) < 1e-9 && 
+             fabs(branches[500].get(1).getPoolCarbon(CarbonTracker::SOIL) - 5) < 1e-9, "Branch write was lost");
+    H_ASSERT(branches[500].get(1000).getTotalCarbon() == 1100, "Shared pool reads wrong");
+
+    // forks run on their own threads - each writes every block, forks again and writes the fork, while the base
+    // and the other forks keep reading the blocks they share
+    CarbonTracker::startTracking();
+    vector<ScenarioState> workers(4, base.fork());
+    vector<double> sums(workers.size());
+    vector<std::thread> threads;
+    for(size_t w = 0; w < workers.size(); ++w){
+        threads.push_back(std::thread([&workers, &sums, w](){
+            ScenarioState& mine = workers[w];
+            for(size_t i = 0; i + 1 < mine.size(); i += ScenarioState::BLOCK_POOLS){
+                CarbonTracker from = mine.get(i), to = mine.get(i + 1);
+                CarbonTracker::transfer(from, to, Hector::unitval(1.0 + w, Hector::U_PGC));
+                mine.modify(i) = from;
+                mine.modify(i + 1) = to;
+            }
+            ScenarioState child = mine.fork();
+            child.modify(0) = child.get(1);
+            mine.modify(2) = mine.get(3);
+            sums[w] = child.get(0).getTotalCarbon().value(Hector::U_PGC) + mine.get(0).getTotalCarbon().value(Hector::U_PGC);
+        }));
+    }
+    for(size_t w = 0; w < threads.size(); ++w){
+        threads[w].join();
+    }
+    CarbonTracker::stopTracking();
+    H_ASSERT(base.get(0).getTotalCarbon() == 100 && base.get(2).getTotalCarbon() == 102, "Threaded branch writes leaked into the base");
+    for(size_t w = 0; w < workers.size(); ++w){
+        H_ASSERT(fabs(sums[w] - (101 + 1.0 + w) - (100 - 1.0 - w)) < 1e-9, "Threaded branch lost a write");
+        H_ASSERT(workers[w].get(2).getTotalCarbon() == 103 && workers[w].get(64).getTotalCarbon() == 164 - 1.0 - w, 
+                 "Threaded branch reads wrong");
+    }
+}
+
+void testFluxReduction(){
+    cout<<"Deterministic Flux Reduction Test"<<endl;
+    CarbonTracker::startTracking();
+    CarbonTracker soil(Hector::unitval(1e6, Hector::U_PGC), CarbonTracker::SOIL);
+    CarbonTracker topOcean(Hector::unitval(1e6, Hector::U_PGC), CarbonTracker::TOPOCEAN);
+    // a few thousand cell fluxes of very different sizes - enough leaves for the threads to split
+    vector<CarbonTracker> fluxes;
+    for(int cell = 0; cell < 3000; ++cell){
+        CarbonTracker& from = cell % 3 ? soil : topOcean;
+        fluxes.push_back(from.fluxFromTrackerPool(Hector::unitval(0.1 + (cell % 97) * 1e-3 + (cell % 7 ? 0 : 10), Hector::U_PGC)));
+    }
+    // bitwise equal - == on every double
+    auto identical = [](CarbonTracker a, CarbonTracker b){
+        return a.getTotalCarbon() == b.getTotalCarbon() && sameCTArrays(a.getOriginFracs(), b.getOriginFracs()) && 
+               a.getUntrackedFrac() == b.getUntrackedFrac();
+    };
+    CarbonTracker serial = FluxReduction::reduce(fluxes);
+    for(int threads = 2; threads <= 8; ++threads){
+        H_ASSERT(identical(serial, FluxReduction::reduce(fluxes, threads)), "Reduction depends on the thread count");
+    }
+    H_ASSERT(identical(FluxReduction::reduce(fluxes, 1, FluxReduction::PLAIN), FluxReduction::reduce(fluxes, 5, FluxReduction::PLAIN)), 
+             "Plain reduction depends on the thread count");
+
+    long double exact = 0;
+    long double exactSoil = 0;
+    CarbonTracker sum = fluxes[0];
+    for(size_t i = 0; i < fluxes.size(); ++i){
+        exact += fluxes[i].getTotalCarbon().value(Hector::U_PGC);
+        exactSoil += fluxes[i].getPoolCarbon(CarbonTracker::SOIL).value(Hector::U_PGC);
+        if(i){
+            sum = sum + fluxes[i];
+        }
+    }
+    CarbonTracker::stopTracking();
+    H_ASSERT(fabs(serial.getTotalCarbon().value(Hector::U_PGC) - (double)exact) <= 1e-15 * (double)exact, "Compensated reduction is inaccurate");
+    H_ASSERT(fabs(serial.getPoolCarbon(CarbonTracker::SOIL).value(Hector::U_PGC) - (double)exactSoil) < 1e-9 && 
+             fabs(serial.getOriginFracs()[CarbonTracker::SOIL] - sum.getOriginFracs()[CarbonTracker::SOIL]) < 1e-12, 
+             "Reduction mixed origins wrong");
+}
+
+void testFluxAccumulator(){
+    cout<<"Per-thread Flux Accumulator Test"<<endl;
+    CarbonTracker::startTracking();
+    CarbonTracker atmos(Hector::unitval(500, Hector::U_PGC), CarbonTracker::ATMOSPHERE);
+    CarbonTracker topOcean(Hector::unitval(900, Hector::U_PGC), CarbonTracker::TOPOCEAN);
+    CarbonTracker sources[] = {CarbonTracker(Hector::unitval(1000, Hector::U_PGC), CarbonTracker::SOIL),
+                               CarbonTracker(Hector::unitval(1000, Hector::U_PGC), CarbonTracker::DEEPOCEAN)};
+    FluxAccumulator accumulator;
+    // each component owns its source pool and deposits into the shared destinations with no lock
+    vector<thread> components;
+    for(int c = 0; c < 2; ++c){
+        components.push_back(thread([&accumulator, &sources, c](){
+            for(int i = 0; i < 1000; ++i){
+                CarbonTracker flux = sources[c].fluxFromTrackerPool(Hector::unitval(0.25, Hector::U_PGC));
+                sources[c] = sources[c] - flux;
+                accumulator.deposit(i % 2 ? CarbonTracker::ATMOSPHERE : CarbonTracker::TOPOCEAN, flux);
+            }
+        }));
+    }
+    for(size_t c = 0; c < components.size(); ++c){
+        components[c].join();
+    }
+    accumulator.merge(atmos);
+    accumulator.merge(topOcean);
+    CarbonTracker::stopTracking();
+
+    H_ASSERT(accumulator.threadCount() == 2, "Threads didn't get their own slots");
+    H_ASSERT(fabs(atmos.getTotalCarbon().value(Hector::U_PGC) - 750) < 1e-9 && fabs(topOcean.getTotalCarbon().value(Hector::U_PGC) - 1150) < 1e-9, 
+             "Merged totals are wrong");
+    H_ASSERT(fabs(atmos.getPoolCarbon(CarbonTracker::SOIL) - 125) < 1e-9 && fabs(atmos.getPoolCarbon(CarbonTracker::DEEPOCEAN) - 125) < 1e-9 && 
+             fabs(topOcean.getPoolCarbon(CarbonTracker::TOPOCEAN) - 900) < 1e-9, "Merged origins are wrong");
+    // merging clears the step's deposits
+    accumulator.merge(atmos);
+    H_ASSERT(fabs(atmos.getTotalCarbon().value(Hector::U_PGC) - 750) < 1e-9, "Deposits were merged twice");
+}
+
+void testInvariantChecker(){
+    cout<<"Asynchronous Invariant Checker Test"<<endl;
+    CarbonTracker::startTracking();
+    CarbonTracker pools[] = {CarbonTracker(Hector::unitval(100, Hector::U_PGC), CarbonTracker::SOIL),
+                             CarbonTracker(Hector::unitval(50, Hector::U_PGC), CarbonTracker::ATMOSPHERE)};
+    Hector::unitval emissions(2, Hector::U_PGC);
+    CarbonTracker fossil(Hector::unitval(1e6, Hector::U_PGC), CarbonTracker::DEEPOCEAN);
+    {
+        // a small queue, so the main loop runs ahead of the checker and has to wait for it
+        InvariantChecker checker(2, 4);
+        for(uint64_t step = 0; step < 200; ++step){
+            CarbonTracker::transfer(pools[0], pools[1], Hector::unitval(0.1, Hector::U_PGC));
+            if(step){
+                pools[1] = pools[1] + fossil.fluxFromTrackerPool(emissions);
+            }
+            checker.submit(step, pools, step ? 2 : 0);
+        }
+        checker.check();
+        H_ASSERT(checker.checked() == 200, "Checker skipped steps");
+
+        // carbon appearing from nowhere at step 200 - reported with its step, even though later steps pass again
+        pools[1] = pools[1] + fossil.fluxFromTrackerPool(emissions);
+        checker.submit(200, pools);
+        checker.submit(201, pools);
+        InvariantChecker::Failure f = checker.firstFailure();
+        H_ASSERT(f.kind == InvariantChecker::MASS_BALANCE && f.step == 200 && f.msg.find("external flux 0") != string::npos, 
+                 "Mass imbalance wasn't reported");
+        bool threw = false;
+        try{
+            checker.check();
+        }
+        catch(h_exception& e){
+            threw = true;
+        }
+        H_ASSERT(threw, "Failed check didn't throw");
+    }
+    CarbonTracker::stopTracking();
+
+    InvariantChecker fractions(1);
+    CarbonTracker bad = pools[0];
+    bad.getOriginFracs()[CarbonTracker::ATMOSPHERE] = 0.5;
+    fractions.submit(7, &bad);
+    InvariantChecker::Failure f = fractions.firstFailure();
+    H_ASSERT(f.kind == InvariantChecker::FRACTION_SUM && f.step == 7 && f.pool == 0 && f.msg.find("Soil") != string::npos, 
+             "Fraction sum failure wasn't reported");
+}
+
+void testOutputPipeline(){
+    cout<<"Double-buffered Output Test"<<endl;
+    CarbonTracker::startTracking();
+    CarbonTracker pools[] = {CarbonTracker(Hector::unitval(100, Hector::U_PGC), CarbonTracker::SOIL),
+                             CarbonTracker(Hector::unitval(50, Hector::U_PGC), CarbonTracker::ATMOSPHERE)};
+    ostringstream out;
+    TextBuffer expected;
+    expected.append("time,pool,carbon,Soil,Atmosphere,Deep Ocean,Top Ocean,untracked\n");
+    OutputPipeline pipeline(out, 2, 2, 16);
+    // 1000 steps through two buffers of 16 - the simulation runs ahead and the writer catches up
+    for(int step = 0; step < 1000; ++step){
+        CarbonTracker::transfer(pools[0], pools[1], Hector::unitval(0.05, Hector::U_PGC));
+        double time = 1850 + step / 12.0;
+        pipeline.write(time, pools);
+        for(int p = 0; p < 2; ++p){
+            expected.append(time).append(',').append(p ? "Atmosphere" : "Soil").append(',').append(double(pools[p].getTotalCarbon()));
+            for(int o = 0; o < CarbonTracker::LAST; ++o){
+                expected.append(',').append(pools[p].getOriginFracs()[o]);
+            }
+            expected.append(',').append(pools[p].getUntrackedFrac()).append('\n');
+        }
+    }
+    CarbonTracker::stopTracking();
+    pipeline.close();
+    H_ASSERT(pipeline.steps() == 1000 && out.str() == expected.str(), "Pipeline output is wrong");
+}
+
+void testOriginHierarchy(){
+    cout<<"Origin Hierarchy Test"<<endl;
+    CarbonTracker::startTracking();
+    // ocean splits into its two layers, land holds the soil - the atmosphere stays directly under the root
+    OriginHierarchy h;
+    int land = h.addGroup("Land");
+    int ocean = h.addGroup("Ocean");
+    h.place(CarbonTracker::SOIL, land);
+    h.place(CarbonTracker::TOPOCEAN, ocean);
+    h.place(CarbonTracker::DEEPOCEAN, ocean);
+    H_ASSERT(h.find("Ocean") == ocean && h.parent(h.find("Deep Ocean")) == ocean && h.parent(land) == OriginHierarchy::ROOT, 
+             "Hierarchy lookup failed");
+
+    CarbonTracker soil(Hector::unitval(100, Hector::U_PGC), CarbonTracker::SOIL);
+    CarbonTracker atmos(Hector::unitval(600, Hector::U_PGC), CarbonTracker::ATMOSPHERE);
+    CarbonTracker deep(Hector::unitval(3000, Hector::U_PGC), CarbonTracker::DEEPOCEAN);
+    CarbonTracker top(Hector::unitval(900, Hector::U_PGC), CarbonTracker::TOPOCEAN);
+    CarbonTracker::transfer(deep, top, Hector::unitval(300, Hector::U_PGC));
+    CarbonTracker::transfer(soil, atmos, Hector::unitval(40, Hector::U_PGC));
+    CarbonTracker::transfer(top, atmos, Hector::unitval(120, Hector::U_PGC));
+
+    // every level agrees with summing the leaves by hand
+    H_ASSERT(h.getPoolCarbon(atmos, land) == atmos.getPoolCarbon(CarbonTracker::SOIL), "Land attribution wrong");
+    double oceanC = double(atmos.getPoolCarbon(CarbonTracker::DEEPOCEAN) + atmos.getPoolCarbon(CarbonTracker::TOPOCEAN));
+    H_ASSERT(fabs(double(h.getPoolCarbon(atmos, ocean)) - oceanC) < 1e-12, "Ocean attribution wrong");
+    H_ASSERT(fabs(double(h.getPoolCarbon(atmos, OriginHierarchy::ROOT)) - 760) < 1e-12, "Root doesn't hold the pool");
+    H_ASSERT(h.getPoolCarbon(atmos, OriginHierarchy::node(CarbonTracker::TOPOCEAN)) == atmos.getPoolCarbon(CarbonTracker::TOPOCEAN), 
+             "Origin node differs from the flat query");
+
+    vector<double> sub(h.size());
+    h.subtotals(atmos, &sub[0]);
+    for(size_t n = 0; n < h.size(); ++n){
+        H_ASSERT(fabs(sub[n] - double(h.getPoolCarbon(atmos, (int)n))) < 1e-12, "Subtotal differs for " + h.name((int)n));
+    }
+    H_ASSERT(fabs(sub[land] + sub[ocean] + sub[OriginHierarchy::node(CarbonTracker::ATMOSPHERE)] - sub[OriginHierarchy::ROOT]) < 1e-12, 
+             "Groups don't add up to the root");
+
+    // an empty group holds nothing, and names must be unique
+    int veg = h.addGroup("Vegetation", land);
+    H_ASSERT(h.getPoolCarbon(atmos, veg) == 0 && h.getPoolCarbon(atmos, land) == atmos.getPoolCarbon(CarbonTracker::SOIL), 
+             "Empty group holds carbon");
+    bool threw = false;
+    try{
+        h.addGroup("Ocean");
+    }
+    catch(h_exception& e){
+        threw = true;
+    }
+    H_ASSERT(threw, "Duplicate group name accepted");
+    CarbonTracker::stopTracking();
+}
+
+#ifdef CARBONTRACKER_NO_TRACKING
+void testNoTracking(){
+    cout<<"Tracking Compiled Out Test"<<endl;
+    bool refused = false;
+    try{
+        CarbonTracker::startTracking();
+    }
+    catch(h_exception& e){
+        refused = true;
+    }
+    H_ASSERT(refused && !CarbonTracker::isTracking(), "Tracking starts although it was compiled out");
+    H_ASSERT(ct_start_tracking() == CT_ERROR && string(ct_last_error()).find("compiled out") != string::npos, 
+             "C ABI doesn't report tracking compiled out");
+
+    // only the totals move - every pool keeps the fractions it was created with
+    CarbonTracker soil(Hector::unitval(100, Hector::U_PGC), CarbonTracker::SOIL);
+    CarbonTracker atmos(Hector::unitval(50, Hector::U_PGC), CarbonTracker::ATMOSPHERE);
+    CarbonTracker topOcean(Hector::unitval(80, Hector::U_PGC), CarbonTracker::TOPOCEAN);
+    CarbonTracker flux = soil.fluxFromTrackerPool(Hector::unitval(10, Hector::U_PGC));
+    soil = soil - flux;
+    atmos = atmos + flux;
+    CarbonTracker::transfer(atmos, topOcean, Hector::unitval(5, Hector::U_PGC));
+    CarbonTracker::exchange(soil, topOcean, 0.1, 0.05, 1);
+    double atmosArr[] = {0, 1, 0, 0};
+    double topOceanArr[] = {0, 0, 0, 1};
+    H_ASSERT(atmos.getTotalCarbon() == 55 && sameCTArrays(atmos.getOriginFracs(), atmosArr) && 
+             sameCTArrays(topOcean.getOriginFracs(), topOceanArr), "Untracked build changes fractions");
+    H_ASSERT(fabs(double(soil.getTotalCarbon() + atmos.getTotalCarbon() + topOcean.getTotalCarbon()) - 230) < 1e-9, 
+             "Untracked build doesn't conserve carbon");
+
+    // a flux in the wrong units is caught in this build too
+    double proportions[] = {1, 0, 0, 0};
+    int caught = 0;
+    try{
+        soil.fluxFromTrackerPool(Hector::unitval(1, Hector::U_YRS));
+    }
+    catch(h_exception& e){
+        ++caught;
+    }
+    try{
+        soil.fluxFromTrackerPool(Hector::unitval(1, Hector::U_YRS), proportions);
+    }
+    catch(h_exception& e){
+        ++caught;
+    }
+    H_ASSERT(caught == 2, "Untracked build accepts a flux in the wrong units");
+}
+#endif
 
 int main(int argc, char* argv[]){
     cout << "Time for Tests!" << endl;
     testTrackerStartsFalse();
+#ifdef CARBONTRACKER_NO_TRACKING
+    // tracking is compiled out - the tests below that start tracking are left out, this covers the build instead
+    testNoTracking();
+#else
     testIsTrackingAndStartTracking();
+#endif
     testCorrectConstructor();
     //testWrongConstructor();
     //testNegCarbonConstructor();
     testCopyConstructor();
     testAssignmentOperator();
+#ifndef CARBONTRACKER_NO_TRACKING
     testAddOperator();
+#endif
     //testFrozenPoolAddPool();
     testUnitValSubtractOperator();
     //testWrongSubtraction();
+#ifndef CARBONTRACKER_NO_TRACKING
     testSubtractionWithArray();
+#endif
     testMultiplication();
     testDivision();
     //testDivisionBy0();
@@ -358,11 +1550,42 @@ int main(int argc, char* argv[]){
     testGetTotalCarbon();
     testGetOriginFracs();
     testGetPoolCarbon();
+#ifndef CARBONTRACKER_NO_TRACKING
     testFluxFromTrackerPool();
     testFluxFromTrackerPoolWithArray();
+    testWrongFluxProportionsSum();
     //testWrongFluxFromTrackerPoolSize();
     //testWrongFluxFromTrackerPoolUnits();
     testPrint();
+    testJournalReplay();
+    testAttributionHistory();
+    testAdjointTape();
+    testDualCarbonTracker();
+    testBatchCarbonTracker();
+    testUncertaintyPropagation();
+    testTrackingMask();
+    testTopKTracking();
+#endif
+    testReplayAcrossSteps();
+#ifndef CARBONTRACKER_NO_TRACKING
+    testTransfer();
+#endif
+    testValidationStatus();
+    testTracer();
+    testTrackerStats();
+#ifndef CARBONTRACKER_NO_TRACKING
+    testCompressedHistory();
+    testTextBuffer();
+    testCABI();
+    testAdaptiveStepper();
+    testExchange();
+    testScenarioFork();
+    testFluxReduction();
+    testFluxAccumulator();
+    testInvariantChecker();
+    testOutputPipeline();
+    testOriginHierarchy();
+#endif
 
     }
 
@@ -0,0 +1,98 @@
+#include "originHierarchy.hpp"
+
+using namespace std;
+
+extern string POOLNAMES[];
+
+OriginHierarchy::OriginHierarchy(const string& rootName){
+    Node root = {rootName, -1, true, 0, 0};
+    nodes.push_back(root);
+    for(int o = 0; o < CarbonTracker::LAST; ++o){
+        Node origin = {POOLNAMES[o], ROOT, false, 0, 0};
+        nodes.push_back(origin);
+    }
+    layout();
+}
+
+int OriginHierarchy::addGroup(const string& name, int parent){
+    H_ASSERT(parent >= 0 && parent < (int)nodes.size() && nodes[parent].group, "Groups can only be added under a group");
+    for(size_t n = 0; n < nodes.size(); ++n){
+        H_ASSERT(nodes[n].name != name, "Duplicate node name " + name);
+    }
+    // empty until an origin is placed in it - layout gives it an empty range
+    Node group = {name, parent, true, 0, 0};
+    nodes.push_back(group);
+    layout();
+    return (int)nodes.size() - 1;
+}
+
+int OriginHierarchy::place(CarbonTracker::Pool origin, int group){
+    H_ASSERT(origin != CarbonTracker::LAST, "LAST is not an origin");
+    H_ASSERT(group >= 0 && group < (int)nodes.size() && nodes[group].group, "Origins can only be placed in a group");
+    nodes[node(origin)].parent = group;
+    layout();
+    return node(origin);
+}
+
+void OriginHierarchy::layout(){
+    int placed = place(ROOT, 0);
+    H_ASSERT(placed == CarbonTracker::LAST, "Hierarchy lost an origin");
+}
+
+int OriginHierarchy::place(int n, int next){
+    // children in the order they were added - a handful of nodes, so a scan is cheaper than child lists
+    nodes[n].begin = next;
+    if(!nodes[n].group){
+        order[next] = n - 1;
+        ++next;
+    }
+    for(size_t c = 1; c < nodes.size(); ++c){
+        if(nodes[c].parent == n){
+            next = place((int)c, next);
+        }
+    }
+    nodes[n].end = next;
+    return next;
+}
+
+int OriginHierarchy::find(const string& name) const{
+    for(size_t n = 0; n < nodes.size(); ++n){
+        if(nodes[n].name == name){
+            return (int)n;
+        }
+    }
+    H_THROW("No origin or group named " + name);
+}
+
+const string& OriginHierarchy::name(int node) const{
+    H_ASSERT(node >= 0 && node < (int)nodes.size(), "Node out of range");
+    return nodes[node].name;
+}
+
+int OriginHierarchy::parent(int node) const{
+    H_ASSERT(node >= 0 && node < (int)nodes.size(), "Node out of range");
+    return nodes[node].parent;
+}
+
+Hector::unitval OriginHierarchy::getPoolCarbon(CarbonTracker& ct, int node) const{
+    H_ASSERT(node >= 0 && node < (int)nodes.size(), "Node out of range");
+    double* fracs = ct.getOriginFracs();
+    double frac = 0;
+    for(int i = nodes[node].begin; i < nodes[node].end; ++i){
+        frac += fracs[order[i]];
+    }
+    return frac * ct.getTotalCarbon();
+}
+
+void OriginHierarchy::subtotals(CarbonTracker& ct, double* out) const{
+    double* fracs = ct.getOriginFracs();
+    double total = ct.getTotalCarbon().value(Hector::U_PGC);
+    double prefix[CarbonTracker::LAST + 1];
+    prefix[0] = 0;
+    for(int i = 0; i < CarbonTracker::LAST; ++i){
+        prefix[i + 1] = prefix[i] + fracs[order[i]] * total;
+    }
+    for(size_t n = 0; n < nodes.size(); ++n){
+        out[n] = prefix[nodes[n].end] - prefix[nodes[n].begin];
+    }
+}
@@ -0,0 +1,113 @@
+#ifndef ORIGINHIERARCHY_HPP
+#define ORIGINHIERARCHY_HPP
+#include <string>
+#include <vector>
+#include "carbonTracker.hpp"
+
+using namespace std;
+
+  /**
+   * \brief OriginHierarchy Class: named groups of origins (e.g. land, ocean) to report attribution at any level
+   *        while the pools keep tracking the fine grained origins
+   *
+   * Node 0 is the root and nodes 1 to LAST are the origins (node origin + 1), all under the root until placed in
+   * a group. The origins are laid out depth first, so every node covers a contiguous range of that order - a
+   * node's carbon is one range sum, and subtotals gives every node of a pool from one prefix sum pass. Only
+   * tracked carbon is attributed: the root holds the pool minus its untracked carbon
+   */
+  class OriginHierarchy{
+   public:
+
+    static const int ROOT = 0;
+
+   private:
+
+    struct Node {
+      string name;
+      int parent;         // -1 for the root
+      bool group;
+      int begin, end;     // range of order it covers
+    };
+
+    vector<Node> nodes;
+
+    // origins in depth first order
+    int order[CarbonTracker::LAST];
+
+    /**
+      * \brief recomputes order and the node ranges after a change
+      */
+    void layout();
+
+    int place(int node, int next);
+
+   public:
+
+    /**
+      * \brief constructor - every origin directly under the root
+      * \param rootName name of the root node
+      */
+    OriginHierarchy(const string& rootName = "All");
+
+    /**
+      * \brief adds an empty group
+      * \param name name of the group - unique
+      * \param parent group to add it under
+      * \return node of the group
+      */
+    int addGroup(const string& name, int parent = ROOT);
+
+    /**
+      * \brief moves an origin into a group
+      * \param origin origin to move
+      * \param group group it belongs to from now on
+      * \return node of the origin
+      */
+    int place(CarbonTracker::Pool origin, int group);
+
+    /**
+      * \brief node of an origin
+      */
+    static int node(CarbonTracker::Pool origin){
+        return origin + 1;
+    }
+
+    /**
+      * \brief looks a node up by name - throws if there is none
+      */
+    int find(const string& name) const;
+
+    /**
+      * \brief getter for number of nodes
+      */
+    size_t size() const{
+        return nodes.size();
+    }
+
+    /**
+      * \brief getter for a node's name
+      */
+    const string& name(int node) const;
+
+    /**
+      * \brief getter for a node's parent - -1 for the root
+      */
+    int parent(int node) const;
+
+    /**
+      * \brief carbon a pool holds from the origins under a node
+      * \param ct pool to attribute
+      * \param node any node - an origin gives the same as ct.getPoolCarbon(origin)
+      * \return carbon in Pg C
+      */
+    Hector::unitval getPoolCarbon(CarbonTracker& ct, int node) const;
+
+    /**
+      * \brief carbon a pool holds under every node at once, for reporting all levels of one pool
+      * \param ct pool to attribute
+      * \param out size() values in Pg C, indexed by node
+      */
+    void subtotals(CarbonTracker& ct, double* out) const;
+  };
+
+#endif
@@ -0,0 +1,147 @@
+#include "outputPipeline.hpp"
+#include "tracer.hpp"
+
+using namespace std;
+
+extern string POOLNAMES[];
+
+OutputPipeline::OutputPipeline(ostream& out, size_t nPools, size_t nBuffers, size_t stepsPerBuffer)
+    : out(out), nPools(nPools), stepsPerBuffer(stepsPerBuffer), buffers(nBuffers), head(0), count(0), fill(0), filled(0),
+      stopping(false), failed(false), nSteps(0), nWaits(0){
+    H_ASSERT(nPools > 0 && stepsPerBuffer > 0, "Pipeline needs pools and room for a step");
+    H_ASSERT(nBuffers >= 2, "Pipeline needs two buffers to overlap writing with the simulation");
+    for(size_t b = 0; b < nBuffers; ++b){
+        buffers[b].times.resize(stepsPerBuffer);
+        buffers[b].homes.resize(stepsPerBuffer * nPools);
+        buffers[b].data.resize(stepsPerBuffer * nPools * WIDTH);
+        buffers[b].steps = 0;
+    }
+    worker = thread(&OutputPipeline::run, this);
+}
+
+OutputPipeline::~OutputPipeline(){
+    if(worker.joinable()){
+        // no throwing from a destructor - a failed stream is only reported by flush and close
+        try{
+            close();
+        }
+        catch(...){
+        }
+    }
+}
+
+void OutputPipeline::write(double time, CarbonTracker* pools){
+    CT_TRACE_SPAN("OutputPipeline::write", "io");
+    H_ASSERT(worker.joinable(), "Pipeline is closed");
+    if(filled == 0){
+        unique_lock<mutex> guard(lock);
+        if(count == buffers.size()){
+            ++nWaits;
+            notFull.wait(guard, [this](){ return count < buffers.size(); });
+        }
+        // the buffer after the queued ones belongs to this thread until it is handed off
+        fill = (head + count) % buffers.size();
+    }
+    Buffer& b = buffers[fill];
+    b.times[filled] = time;
+    for(size_t p = 0; p < nPools; ++p){
+        double* d = &b.data[(filled * nPools + p) * WIDTH];
+        d[0] = double(pools[p].getTotalCarbon());
+        double* fracs = pools[p].getOriginFracs();
+        for(int o = 0; o < CarbonTracker::LAST; ++o){
+            d[1 + o] = fracs[o];
+        }
+        d[WIDTH - 1] = pools[p].getUntrackedFrac();
+        b.homes[filled * nPools + p] = pools[p].getHomePool();
+    }
+    ++nSteps;
+    if(++filled == stepsPerBuffer){
+        handOff();
+    }
+}
+
+void OutputPipeline::handOff(){
+    {
+        lock_guard<mutex> guard(lock);
+        buffers[fill].steps = filled;
+        ++count;
+    }
+    filled = 0;
+    notEmpty.notify_one();
+}
+
+void OutputPipeline::run(){
+    // sized for a whole buffer up front, so formatting never grows it
+    TextBuffer text(stepsPerBuffer * nPools * (WIDTH * TextBuffer::DOUBLE_CHARS + 32));
+    text.append("time,pool,carbon");
+    for(int o = 0; o < CarbonTracker::LAST; ++o){
+        text.append(',').append(POOLNAMES[o]);
+    }
+    text.append(",untracked\n");
+    text.writeTo(out);
+
+    unique_lock<mutex> guard(lock);
+    while(true){
+        notEmpty.wait(guard, [this](){ return count > 0 || stopping; });
+        if(count == 0){
+            return;
+        }
+        const Buffer& b = buffers[head];
+        guard.unlock();
+        writeBuffer(b, text);
+        bool bad = !out;
+        guard.lock();
+        failed = failed || bad;
+        head = (head + 1) % buffers.size();
+        --count;
+        notFull.notify_all();
+    }
+}
+
+void OutputPipeline::writeBuffer(const Buffer& b, TextBuffer& text){
+    CT_TRACE_SPAN("OutputPipeline::writeBuffer", "io");
+    text.clear();
+    for(size_t s = 0; s < b.steps; ++s){
+        for(size_t p = 0; p < nPools; ++p){
+            const double* d = &b.data[(s * nPools + p) * WIDTH];
+            int home = b.homes[s * nPools + p];
+            text.append(b.times[s]).append(',').append(home == CarbonTracker::LAST ? "unknown" : POOLNAMES[home].c_str());
+            for(int c = 0; c < WIDTH; ++c){
+                text.append(',').append(d[c]);
+            }
+            text.append('\n');
+        }
+    }
+    text.writeTo(out);
+    out.flush();
+}
+
+void OutputPipeline::flush(){
+    if(filled > 0){
+        handOff();
+    }
+    unique_lock<mutex> guard(lock);
+    notFull.wait(guard, [this](){ return count == 0; });
+    H_ASSERT(!failed, "Output stream failed");
+}
+
+void OutputPipeline::close(){
+    if(!worker.joinable()){
+        return;
+    }
+    if(filled > 0){
+        handOff();
+    }
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    notEmpty.notify_all();
+    worker.join();
+    H_ASSERT(!failed, "Output stream failed");
+}
+
+uint64_t OutputPipeline::waits(){
+    lock_guard<mutex> guard(lock);
+    return nWaits;
+}
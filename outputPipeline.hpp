@@ -0,0 +1,118 @@
+#ifndef OUTPUTPIPELINE_HPP
+#define OUTPUTPIPELINE_HPP
+#include <condition_variable>
+#include <mutex>
+#include <ostream>
+#include <thread>
+#include <vector>
+#include <stdint.h>
+#include "carbonTracker.hpp"
+#include "textBuffer.hpp"
+
+using namespace std;
+
+  /**
+   * \brief OutputPipeline Class: writes the pools' state every step as CSV from a writer thread, so formatting
+   *        and disk I/O overlap with the simulation
+   *
+   * write copies the selected pools into the buffer being filled - nBuffers preallocated buffers of
+   * stepsPerBuffer steps each, used round robin. A full buffer is handed to the writer thread, which formats it
+   * with a TextBuffer, writes it to the stream and flushes. The simulation only waits (back-pressure) when every
+   * buffer is still queued for the writer, i.e. when output is produced faster than the stream takes it.
+   * One row per pool per step: time, pool, carbon (Pg C), the origin fractions and the untracked fraction
+   */
+  class OutputPipeline{
+   private:
+    // per pool per step - total carbon, origin fractions, untracked fraction
+    static const int WIDTH = CarbonTracker::LAST + 2;
+
+    struct Buffer {
+      vector<double> times;
+      vector<int> homes;
+      vector<double> data;
+      size_t steps;       // steps held
+    };
+
+    ostream& out;
+    size_t nPools;
+    size_t stepsPerBuffer;
+    vector<Buffer> buffers;
+
+    size_t head;          // oldest buffer queued for the writer
+    size_t count;         // buffers queued for the writer - the one being filled comes after them
+    size_t fill;          // buffer being filled
+    size_t filled;        // steps in it
+    bool stopping;
+    bool failed;
+
+    uint64_t nSteps;
+    uint64_t nWaits;
+
+    mutex lock;
+    condition_variable notEmpty;
+    condition_variable notFull;
+    thread worker;
+
+    // Make the copy constructs private and undefined - the pipeline owns a thread
+    OutputPipeline(const OutputPipeline&);
+    OutputPipeline& operator=(const OutputPipeline&);
+
+    void run();
+
+    /**
+      * \brief formats and writes one buffer - only on the writer thread
+      */
+    void writeBuffer(const Buffer& b, TextBuffer& text);
+
+    /**
+      * \brief queues the buffer being filled for the writer
+      */
+    void handOff();
+
+   public:
+
+    /**
+      * \brief constructor - starts the writer thread, which writes the header row first
+      * \param out stream to write to - only the writer thread touches it until close
+      * \param nPools number of pools written every step
+      * \param nBuffers buffers to cycle through - at least 2, so one fills while another is written
+      * \param stepsPerBuffer steps a buffer holds before it is handed to the writer
+      */
+    OutputPipeline(ostream& out, size_t nPools, size_t nBuffers = 2, size_t stepsPerBuffer = 64);
+
+    /**
+      * \brief destructor - writes everything still buffered
+      */
+    ~OutputPipeline();
+
+    /**
+      * \brief copies the pools' state at the end of a step for writing - waits only if every buffer is queued
+      * \param time model time of the step
+      * \param pools the nPools pools to write
+      */
+    void write(double time, CarbonTracker* pools);
+
+    /**
+      * \brief hands over a partly filled buffer and waits until everything written so far is in the stream
+      */
+    void flush();
+
+    /**
+      * \brief flushes and stops the writer thread - no more writes after this
+      */
+    void close();
+
+    /**
+      * \brief getter for number of steps written
+      */
+    uint64_t steps() const{
+        return nSteps;
+    }
+
+    /**
+      * \brief getter for how often write had to wait for the writer
+      */
+    uint64_t waits();
+  };
+
+#endif
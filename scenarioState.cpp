@@ -0,0 +1,61 @@
+#include "scenarioState.hpp"
+
+using namespace std;
+
+const size_t ScenarioState::BLOCK_POOLS;
+
+ScenarioState::ScenarioState() : nPools(0){
+}
+
+ScenarioState::ScenarioState(const ScenarioState& other)
+    : blocks(other.blocks), owned(other.blocks.size(), false), nPools(other.nPools){
+    other.owned.assign(other.owned.size(), false);
+}
+
+ScenarioState& ScenarioState::operator=(const ScenarioState& other){
+    if(this != &other){
+        blocks = other.blocks;
+        owned.assign(blocks.size(), false);
+        nPools = other.nPools;
+        other.owned.assign(other.owned.size(), false);
+    }
+    return *this;
+}
+
+size_t ScenarioState::add(const CarbonTracker& ct){
+    if(nPools % BLOCK_POOLS == 0){
+        blocks.push_back(make_shared<Block>());
+        blocks.back()->pools.reserve(BLOCK_POOLS);
+        owned.push_back(true);
+    }
+    else if(!owned.back()){
+        blocks.back() = make_shared<Block>(*blocks.back());
+        owned.back() = true;
+    }
+    blocks.back()->pools.push_back(ct);
+    return nPools++;
+}
+
+CarbonTracker ScenarioState::get(size_t i) const{
+    H_ASSERT(i < nPools, "No such pool in the scenario");
+    return blocks[i / BLOCK_POOLS]->pools[i % BLOCK_POOLS];
+}
+
+CarbonTracker& ScenarioState::modify(size_t i){
+    H_ASSERT(i < nPools, "No such pool in the scenario");
+    size_t b = i / BLOCK_POOLS;
+    if(!owned[b]){
+        // a block we don't own may be read by other states (on other threads) - copy it rather than write it
+        blocks[b] = make_shared<Block>(*blocks[b]);
+        owned[b] = true;
+    }
+    return blocks[b]->pools[i % BLOCK_POOLS];
+}
+
+size_t ScenarioState::ownedBlocks() const{
+    size_t count = 0;
+    for(size_t b = 0; b < blocks.size(); ++b){
+        count += owned[b];
+    }
+    return count;
+}
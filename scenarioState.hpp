@@ -0,0 +1,100 @@
+#ifndef SCENARIOSTATE_HPP
+#define SCENARIOSTATE_HPP
+#include <memory>
+#include <vector>
+#include "carbonTracker.hpp"
+
+using namespace std;
+
+  /**
+   * \brief ScenarioState Class: the pools of one scenario, forkable copy-on-write
+   *
+   * Pools are kept in blocks of BLOCK_POOLS. A fork (or a copy) shares every block with its parent, so it costs
+   * one pointer per block however many pools there are. The first modify of a pool in a shared block copies just
+   * that block for the state doing the writing - a branch only pays for the blocks it changes, and the parent
+   * and every other branch keep seeing the shared values. A state and its forks may each be used from a
+   * different thread, as long as each state is only used by one thread at a time. Whether a block may be written
+   * in place is kept per state (set when the state makes its own copy, cleared on both sides of a fork) rather
+   * than read from the shared count, which another thread's fork or release can change at any time
+   */
+  class ScenarioState{
+   public:
+
+    // pools per block - the granularity of sharing
+    static const size_t BLOCK_POOLS = 64;
+
+   private:
+
+    struct Block {
+      vector<CarbonTracker> pools;
+    };
+
+    vector<shared_ptr<Block> > blocks;
+
+    // blocks this state made itself and never shared since - only these are written in place. Mutable since a
+    // fork (a copy of a const state) gives up the parent's ownership too
+    mutable vector<bool> owned;
+    size_t nPools;
+
+   public:
+
+    ScenarioState();
+
+    /**
+      * \brief copy constructor - shares every block, which neither state owns from now on
+      */
+    ScenarioState(const ScenarioState& other);
+
+    ScenarioState& operator=(const ScenarioState& other);
+
+    /**
+      * \brief appends a pool
+      * \param ct pool to add
+      * \return its index in the state
+      */
+    size_t add(const CarbonTracker& ct);
+
+    /**
+      * \brief getter for number of pools
+      */
+    size_t size() const{
+        return nPools;
+    }
+
+    /**
+      * \brief a pool's current value, without unsharing anything
+      * \param i index of the pool
+      * \return copy of the pool
+      */
+    CarbonTracker get(size_t i) const;
+
+    /**
+      * \brief a pool to change in place - copies its block first if another state shares it
+      * \param i index of the pool
+      * \return the pool, valid until the next add or modify
+      */
+    CarbonTracker& modify(size_t i);
+
+    /**
+      * \brief a new scenario that starts from this state and shares all its storage until either side writes
+      * \return the forked state
+      */
+    ScenarioState fork() const{
+        return *this;
+    }
+
+    /**
+      * \brief getter for number of blocks
+      */
+    size_t blockCount() const{
+        return blocks.size();
+    }
+
+    /**
+      * \brief getter for number of blocks this state has written since it was last forked or copied - what it
+      *        costs beyond its parent
+      */
+    size_t ownedBlocks() const;
+  };
+
+#endif
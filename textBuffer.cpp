@@ -0,0 +1,102 @@
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+#include "textBuffer.hpp"
+#include "carbonTracker.hpp"
+
+using namespace std;
+
+extern string POOLNAMES[];
+
+const size_t TextBuffer::DOUBLE_CHARS;
+
+char* TextBuffer::formatDouble(char* out, double v){
+    if(v != v){
+        memcpy(out, "nan", 3);
+        return out + 3;
+    }
+    if(std::isinf(v)){
+        if(v < 0){
+            *out++ = '-';
+        }
+        memcpy(out, "inf", 3);
+        return out + 3;
+    }
+    if(v == floor(v) && fabs(v) < 1e15){
+        // whole numbers - pool sizes set from input mostly are - need no search
+        if(std::signbit(v)){
+            *out++ = '-';
+        }
+        uint64_t n = (uint64_t)fabs(v);
+        char digits[20];
+        int nDigits = 0;
+        do{
+            digits[nDigits++] = (char)('0' + n % 10);
+            n /= 10;
+        } while(n);
+        while(nDigits){
+            *out++ = digits[--nDigits];
+        }
+        return out;
+    }
+    // %g drops trailing zeros, so the first precision that reads back exactly is the shortest - 17 always does
+    int n = 0;
+    for(int precision = 15; precision <= 17; ++precision){
+        n = snprintf(out, DOUBLE_CHARS, "%.*g", precision, v);
+        if(strtod(out, NULL) == v){
+            break;
+        }
+    }
+    return out + n;
+}
+
+TextBuffer::TextBuffer(size_t capacity) : chars(capacity), length(0){
+}
+
+TextBuffer& TextBuffer::append(const char* s, size_t n){
+    memcpy(reserve(n), s, n);
+    length += n;
+    return *this;
+}
+
+TextBuffer& TextBuffer::append(const char* s){
+    return append(s, strlen(s));
+}
+
+TextBuffer& TextBuffer::append(const string& s){
+    return append(s.data(), s.size());
+}
+
+TextBuffer& TextBuffer::append(char c){
+    *reserve(1) = c;
+    ++length;
+    return *this;
+}
+
+TextBuffer& TextBuffer::append(double v){
+    char* start = reserve(DOUBLE_CHARS);
+    length += formatDouble(start, v) - start;
+    return *this;
+}
+
+TextBuffer& TextBuffer::append(const Hector::unitval& v){
+    // the units are the unitval's own, so value() has nothing to check
+    append((double)v);
+    append(' ');
+    return append(Hector::unitval::unitsNameCStr(v.units()));
+}
+
+TextBuffer& TextBuffer::append(CarbonTracker& ct){
+    Hector::unitval total = ct.getTotalCarbon();
+    const char* units = Hector::unitval::unitsNameCStr(total.units());
+    double* fracs = ct.getOriginFracs();
+    for(int i = 0; i < CarbonTracker::LAST; ++i){
+        append(POOLNAMES[i]).append(": ").append(fracs[i] * (double)total).append(' ').append(units).append(" \n");
+    }
+    if(ct.getUntrackedFrac() != 0){
+        append("untracked: ").append(ct.getUntrackedFrac() * (double)total).append(' ').append(units).append(" \n");
+    }
+    return *this;
+}
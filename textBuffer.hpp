@@ -0,0 +1,109 @@
+#ifndef TEXTBUFFER_HPP
+#define TEXTBUFFER_HPP
+#include <ostream>
+#include <string>
+#include <vector>
+#include "unitval.hpp"
+
+using namespace std;
+
+class CarbonTracker;
+
+  /**
+   * \brief TextBuffer Class: appends text, numbers, unitvals and whole CarbonTracker snapshots to one reusable
+   *        character buffer
+   *
+   * Nothing is built through a stream or a temporary string - doubles are written by formatDouble and unit names
+   * come from a static table. clear keeps the capacity, so once the buffer has grown to the largest snapshot a
+   * run writes, formatting makes no heap call. The stream operators are left as they are, so they keep the
+   * stream's precision and width - output that doesn't need them can write through a TextBuffer instead
+   */
+  class TextBuffer{
+   private:
+    vector<char> chars;
+    size_t length;
+
+    /**
+      * \brief makes room for n more characters
+      * \return where they go
+      */
+    char* reserve(size_t n){
+        if(length + n > chars.size()){
+            chars.resize(2 * (length + n));
+        }
+        return &chars[length];
+    }
+
+   public:
+
+    // characters formatDouble can write
+    static const size_t DOUBLE_CHARS = 32;
+
+    /**
+      * \brief writes the shortest text that reads back as exactly v - integers below 1e15 are written digit by
+      *        digit, everything else with the fewest of 15, 16 or 17 significant digits that round trips
+      * \param out where to write - room for at least DOUBLE_CHARS characters, not null terminated
+      * \param v value to write
+      * \return one past the last character written
+      */
+    static char* formatDouble(char* out, double v);
+
+    /**
+      * \brief constructor
+      * \param capacity characters to make room for up front
+      */
+    TextBuffer(size_t capacity = 256);
+
+    TextBuffer& append(const char* s, size_t n);
+    TextBuffer& append(const char* s);
+    TextBuffer& append(const string& s);
+    TextBuffer& append(char c);
+
+    /**
+      * \brief appends a double, shortest round trip form
+      */
+    TextBuffer& append(double v);
+
+    /**
+      * \brief appends a unitval as value and units name, e.g. "10 Pg C"
+      */
+    TextBuffer& append(const Hector::unitval& v);
+
+    /**
+      * \brief appends the carbon of each origin in a pool, one "Origin: carbon Pg C" line each, plus the
+      *        untracked carbon if there is any - the layout of operator<<, with shortest round trip values
+      */
+    TextBuffer& append(CarbonTracker& ct);
+
+    const char* data() const{
+        return length ? &chars[0] : "";
+    }
+
+    size_t size() const{
+        return length;
+    }
+
+    size_t capacity() const{
+        return chars.size();
+    }
+
+    /**
+      * \brief empties the buffer, keeping its capacity
+      */
+    void clear(){
+        length = 0;
+    }
+
+    string str() const{
+        return string(data(), length);
+    }
+
+    /**
+      * \brief writes the buffer to a stream in one call
+      */
+    void writeTo(ostream& out) const{
+        out.write(data(), length);
+    }
+  };
+
+#endif
@@ -0,0 +1,148 @@
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <vector>
+#include "tracer.hpp"
+#include "h_exception.hpp"
+
+using namespace std;
+
+const size_t Tracer::THREAD_EVENTS;
+CT_THREAD_LOCAL Tracer::ThreadBuffer* Tracer::current = NULL;
+
+// guards the registry, the free buffers and the clock base
+static mutex registryLock;
+
+// tick and clock reading taken together when the first thread registers - the clock base for the tick rate
+static uint64_t startTicks;
+static chrono::steady_clock::time_point startTime;
+
+vector<unique_ptr<Tracer::ThreadBuffer> >& Tracer::registry(){
+    static vector<unique_ptr<ThreadBuffer> > buffers;
+    return buffers;
+}
+
+vector<Tracer::ThreadBuffer*>& Tracer::freeBuffers(){
+    static vector<ThreadBuffer*> buffers;
+    return buffers;
+}
+
+Tracer::ThreadBuffer* Tracer::registerThread(){
+    // built on the thread's first event, so only threads that record pay for the exit hook
+    static thread_local Release release;
+    lock_guard<mutex> lock(registryLock);
+    ThreadBuffer* b;
+    if(!freeBuffers().empty()){
+        // the lock orders the last thread's events before ours - keep them and append after
+        b = freeBuffers().back();
+        freeBuffers().pop_back();
+    }
+    else{
+        if(registry().empty()){
+            startTime = chrono::steady_clock::now();
+            startTicks = now();
+        }
+        b = new ThreadBuffer(registry().size());
+        registry().push_back(unique_ptr<ThreadBuffer>(b));
+    }
+    current = b;
+    return b;
+}
+
+Tracer::Release::~Release(){
+    lock_guard<mutex> lock(registryLock);
+    freeBuffers().push_back(current);
+    current = NULL;
+}
+
+// writes s as a JSON string - names are literals, so only quotes and backslashes need escaping
+static void writeString(ostream& out, const char* s){
+    out << '"';
+    for(; *s; ++s){
+        if(*s == '"' || *s == '\\'){
+            out << '\\';
+        }
+        out << *s;
+    }
+    out << '"';
+}
+
+void Tracer::write(const string& path){
+    ofstream out(path.c_str());
+    H_ASSERT(out.is_open(), "Could not open trace file " + path);
+    lock_guard<mutex> lock(registryLock);
+
+    // ticks per microsecond from the time since the first event - wait a little if that is too short to measure
+    double ticksPerUs = 1;
+    if(!registry().empty()){
+        chrono::steady_clock::time_point endTime;
+        uint64_t endTicks;
+        do{
+            endTime = chrono::steady_clock::now();
+            endTicks = now();
+        } while(endTime - startTime < chrono::milliseconds(10));
+        ticksPerUs = (endTicks - startTicks) / chrono::duration<double, micro>(endTime - startTime).count();
+    }
+
+    out << "{\"traceEvents\":[";
+    out.setf(ios::fixed);
+    out.precision(3);
+    bool first = true;
+    for(size_t t = 0; t < registry().size(); ++t){
+        const ThreadBuffer* b = registry()[t].get();
+        size_t n = b->count.load(memory_order_acquire);
+        for(size_t i = 0; i < n; ++i){
+            const Event& e = b->events[i];
+            out << (first ? "\n" : ",\n") << "{\"name\":";
+            writeString(out, e.name);
+            out << ",\"cat\":";
+            writeString(out, e.cat);
+            out << ",\"ph\":\"" << e.phase << "\",\"pid\":1,\"tid\":" << b->tid
+                << ",\"ts\":" << (double)(int64_t)(e.start - startTicks) / ticksPerUs;
+            if(e.phase == 'X'){
+                out << ",\"dur\":" << e.dur / ticksPerUs;
+            }
+            else{
+                out.unsetf(ios::fixed);
+                out.precision(17);
+                out << ",\"args\":{\"value\":" << e.value << "}";
+                out.setf(ios::fixed);
+                out.precision(3);
+            }
+            out << "}";
+            first = false;
+        }
+    }
+    out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+size_t Tracer::size(){
+    lock_guard<mutex> lock(registryLock);
+    size_t n = 0;
+    for(size_t t = 0; t < registry().size(); ++t){
+        n += registry()[t]->count.load(memory_order_acquire);
+    }
+    return n;
+}
+
+uint64_t Tracer::dropped(){
+    lock_guard<mutex> lock(registryLock);
+    uint64_t n = 0;
+    for(size_t t = 0; t < registry().size(); ++t){
+        n += registry()[t]->dropped.load(memory_order_relaxed);
+    }
+    return n;
+}
+
+size_t Tracer::buffers(){
+    lock_guard<mutex> lock(registryLock);
+    return registry().size();
+}
+
+void Tracer::clear(){
+    lock_guard<mutex> lock(registryLock);
+    for(size_t t = 0; t < registry().size(); ++t){
+        registry()[t]->count.store(0, memory_order_relaxed);
+        registry()[t]->dropped.store(0, memory_order_relaxed);
+    }
+}
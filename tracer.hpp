@@ -0,0 +1,207 @@
+#ifndef TRACER_HPP
+#define TRACER_HPP
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <chrono>
+#endif
+
+using namespace std;
+
+// Build with CT_ENABLE_TRACING to turn the CT_TRACE_* macros placed around the tracker operations, flux replay
+// and I/O into scoped spans and counters. Without it they compile to nothing. The Tracer itself is always built,
+// so spans can also be opened directly with TraceSpan.
+#define CT_TRACE_CONCAT2(a, b) a##b
+#define CT_TRACE_CONCAT(a, b) CT_TRACE_CONCAT2(a, b)
+#ifdef CT_ENABLE_TRACING
+#define CT_TRACE_SPAN(name, cat) TraceSpan CT_TRACE_CONCAT(traceSpan_, __LINE__)(name, cat)
+#define CT_TRACE_COUNTER(name, value) Tracer::counter(name, value)
+#else
+#define CT_TRACE_SPAN(name, cat)
+#define CT_TRACE_COUNTER(name, value) ((void)0)
+#endif
+
+// GCC and clang can't see that a thread_local defined in another file has no dynamic initializer, so every read
+// of one calls its init function first. __thread is the same storage without the call
+#ifdef __GNUC__
+#define CT_THREAD_LOCAL __thread
+#else
+#define CT_THREAD_LOCAL thread_local
+#endif
+
+  /**
+   * \brief Tracer Class: collects timed spans and counters from every thread and writes them as Chrome trace
+   *        event JSON (chrome://tracing, Perfetto)
+   *
+   * Each thread appends to its own preallocated buffer, so recording takes no lock and makes no heap call -
+   * a full buffer drops events and counts them instead. A thread publishes each event by storing its buffer's
+   * count after the event, so write, size and dropped read only finished events and can run while threads record.
+   * When a thread exits its buffer, events and all, goes to the next thread that starts recording, which carries
+   * on under the same tid - threads that never ran at once share a track, and only as many buffers are ever
+   * allocated as threads recorded at the same time. Timestamps are raw TSC ticks (steady_clock elsewhere)
+   * converted to microseconds only when the trace is written. Names and categories must be string literals,
+   * only the pointers are kept
+   */
+  class Tracer{
+   public:
+
+    // One span ('X') or counter ('C')
+    struct Event {
+      const char* name;
+      const char* cat;
+      uint64_t start;   // ticks
+      uint64_t dur;     // ticks - 0 for counters
+      double value;     // counter value
+      char phase;
+    };
+
+    // events each thread can hold before dropping
+    static const size_t THREAD_EVENTS = 1 << 16;
+
+   private:
+
+    // events of one thread, then of the next thread to reuse it - kept until exit, so a finished thread's events
+    // are still written. Only the owning thread writes events and the counters, others read events below count
+    struct ThreadBuffer {
+      Event* events;                // THREAD_EVENTS slots
+      atomic<size_t> count;
+      atomic<uint64_t> dropped;
+      uint32_t tid;
+
+      ThreadBuffer(uint32_t tid) : events(new Event[THREAD_EVENTS]), count(0), dropped(0), tid(tid){
+      }
+
+      ~ThreadBuffer(){
+          delete[] events;
+      }
+    };
+
+    // buffer of the calling thread - null until it records its first event
+    static CT_THREAD_LOCAL ThreadBuffer* current;
+
+    // hands the calling thread's buffer back when the thread exits
+    struct Release {
+      ~Release();
+    };
+
+    /**
+      * \brief every buffer in registration order - guarded by a lock in tracer.cpp
+      */
+    static vector<unique_ptr<ThreadBuffer> >& registry();
+
+    /**
+      * \brief buffers of finished threads, waiting for a new thread - guarded like the registry
+      */
+    static vector<ThreadBuffer*>& freeBuffers();
+
+    /**
+      * \brief gives the calling thread a finished thread's buffer, or creates and registers a new one
+      */
+    static ThreadBuffer* registerThread();
+
+   public:
+
+    /**
+      * \brief current timestamp in ticks
+      */
+    static uint64_t now(){
+#if defined(__x86_64__) || defined(__i386__)
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    /**
+      * \brief appends an event to the calling thread's buffer
+      */
+    static void record(const char* name, const char* cat, uint64_t start, uint64_t dur, double value, char phase){
+        ThreadBuffer* b = current ? current : registerThread();
+        size_t n = b->count.load(memory_order_relaxed);
+        if(n == THREAD_EVENTS){
+            b->dropped.store(b->dropped.load(memory_order_relaxed) + 1, memory_order_relaxed);
+            return;
+        }
+        Event e = {name, cat, start, dur, value, phase};
+        b->events[n] = e;
+        // release, so a reader that sees the count sees the event
+        b->count.store(n + 1, memory_order_release);
+    }
+
+    /**
+      * \brief records the value of a counter now
+      * \param name counter name (string literal)
+      * \param value value of the counter
+      */
+    static void counter(const char* name, double value){
+        record(name, "counter", now(), 0, value, 'C');
+    }
+
+    /**
+      * \brief writes every thread's events as Chrome trace event JSON - threads may keep recording, their
+      *        events from after the call are left out
+      * \param path file to write
+      */
+    static void write(const string& path);
+
+    /**
+      * \brief getter for the number of events held over all threads
+      * \return event count
+      */
+    static size_t size();
+
+    /**
+      * \brief getter for the number of events dropped because a thread's buffer was full
+      * \return dropped event count
+      */
+    static uint64_t dropped();
+
+    /**
+      * \brief getter for the number of thread buffers allocated
+      * \return most threads that have recorded at the same time
+      */
+    static size_t buffers();
+
+    /**
+      * \brief forgets every recorded event - no thread may be recording while this runs
+      */
+    static void clear();
+  };
+
+
+  /**
+   * \brief TraceSpan Class: records the time from its construction to the end of its scope as one span
+   */
+  class TraceSpan{
+   private:
+    const char* name;
+    const char* cat;
+    uint64_t start;
+
+    TraceSpan(const TraceSpan&);
+    TraceSpan& operator=(const TraceSpan&);
+
+   public:
+
+    /**
+      * \brief constructor - starts the span
+      * \param name span name (string literal)
+      * \param cat category, e.g. "tracker", "io" (string literal)
+      */
+    TraceSpan(const char* name, const char* cat) : name(name), cat(cat), start(Tracer::now()){
+    }
+
+    /**
+      * \brief destructor - ends the span and records it
+      */
+    ~TraceSpan(){
+        Tracer::record(name, cat, start, Tracer::now() - start, 0, 'X');
+    }
+  };
+
+#endif
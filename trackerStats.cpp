@@ -0,0 +1,146 @@
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <vector>
+#include "trackerStats.hpp"
+
+using namespace std;
+
+extern string POOLNAMES[];
+
+thread_local TrackerStats::Slot* TrackerStats::current = NULL;
+
+// guards the registry and the counts of finished threads
+static mutex registryLock;
+
+static const char* OPNAMES[] = {"add", "subtract", "multiply", "divide", "flux", "transfer"};
+
+TrackerStats::Registry::Registry(){
+    memset(&retired, 0, sizeof(Counts));
+}
+
+TrackerStats::Registry::~Registry(){
+    for(size_t m = 0; m < memory.size(); ++m){
+        delete[] memory[m];
+    }
+}
+
+TrackerStats::Registry& TrackerStats::registry(){
+    static Registry r;
+    return r;
+}
+
+void TrackerStats::clear(Slot& s){
+    for(int op = 0; op < N_OPS; ++op){
+        s.ops[op].store(0, memory_order_relaxed);
+    }
+    for(int from = 0; from <= CarbonTracker::LAST; ++from){
+        for(int to = 0; to <= CarbonTracker::LAST; ++to){
+            s.moved[from][to].store(0, memory_order_relaxed);
+        }
+    }
+    s.renormalizations.store(0, memory_order_relaxed);
+    s.checkFailures.store(0, memory_order_relaxed);
+    s.unitFailures.store(0, memory_order_relaxed);
+    s.maxDrift.store(0, memory_order_relaxed);
+}
+
+void TrackerStats::addTo(Counts& total, const Slot& s){
+    for(int op = 0; op < N_OPS; ++op){
+        total.ops[op] += s.ops[op].load(memory_order_relaxed);
+    }
+    for(int from = 0; from <= CarbonTracker::LAST; ++from){
+        for(int to = 0; to <= CarbonTracker::LAST; ++to){
+            total.moved[from][to] += s.moved[from][to].load(memory_order_relaxed);
+        }
+    }
+    total.renormalizations += s.renormalizations.load(memory_order_relaxed);
+    total.checkFailures += s.checkFailures.load(memory_order_relaxed);
+    total.unitFailures += s.unitFailures.load(memory_order_relaxed);
+    double drift = s.maxDrift.load(memory_order_relaxed);
+    if(drift > total.maxDrift){
+        total.maxDrift = drift;
+    }
+}
+
+TrackerStats::Slot* TrackerStats::registerThread(){
+    // built on the thread's first count, so only threads that count pay for the exit hook
+    static thread_local Release release;
+    lock_guard<mutex> lock(registryLock);
+    Slot* s;
+    if(!registry().free.empty()){
+        s = registry().free.back();
+        registry().free.pop_back();
+    }
+    else{
+        // new doesn't promise more than 16 byte alignment before C++17, so line the slot up by hand
+        char* raw = new char[sizeof(Slot) + alignof(Slot)];
+        s = new(reinterpret_cast<void*>((reinterpret_cast<uintptr_t>(raw) + alignof(Slot) - 1) & ~(uintptr_t)(alignof(Slot) - 1))) Slot;
+        clear(*s);
+        registry().memory.push_back(raw);
+        registry().slots.push_back(s);
+    }
+    current = s;
+    return s;
+}
+
+TrackerStats::Release::~Release(){
+    // folded and cleared under the lock, so collect sees the thread's counts exactly once
+    lock_guard<mutex> lock(registryLock);
+    addTo(registry().retired, *current);
+    clear(*current);
+    registry().free.push_back(current);
+    current = NULL;
+}
+
+TrackerStats::Counts TrackerStats::collect(){
+    lock_guard<mutex> lock(registryLock);
+    Counts total = registry().retired;
+    for(size_t t = 0; t < registry().slots.size(); ++t){
+        addTo(total, *registry().slots[t]);
+    }
+    return total;
+}
+
+void TrackerStats::reset(){
+    lock_guard<mutex> lock(registryLock);
+    memset(&registry().retired, 0, sizeof(Counts));
+    for(size_t t = 0; t < registry().slots.size(); ++t){
+        clear(*registry().slots[t]);
+    }
+}
+
+size_t TrackerStats::slots(){
+    lock_guard<mutex> lock(registryLock);
+    return registry().slots.size();
+}
+
+void TrackerStats::writeJson(ostream& out){
+    Counts c = collect();
+    out << "{\"ops\":{";
+    for(int op = 0; op < N_OPS; ++op){
+        out << (op ? "," : "") << "\"" << OPNAMES[op] << "\":" << c.ops[op];
+    }
+    // only the pairs that moved carbon
+    out << "},\"moved\":[";
+    bool first = true;
+    for(int from = 0; from <= CarbonTracker::LAST; ++from){
+        for(int to = 0; to <= CarbonTracker::LAST; ++to){
+            if(c.moved[from][to] != 0){
+                out << (first ? "" : ",") << "{\"from\":\"" << (from == CarbonTracker::LAST ? "unknown" : POOLNAMES[from])
+                    << "\",\"to\":\"" << (to == CarbonTracker::LAST ? "unknown" : POOLNAMES[to]) << "\",\"pgc\":" << c.moved[from][to] << "}";
+                first = false;
+            }
+        }
+    }
+    out << "],\"renormalizations\":" << c.renormalizations << ",\"checkFailures\":" << c.checkFailures
+        << ",\"unitFailures\":" << c.unitFailures << ",\"maxFractionDrift\":" << c.maxDrift << "}";
+}
+
+string TrackerStats::toJson(){
+    ostringstream out;
+    out.precision(17);
+    writeJson(out);
+    return out.str();
+}
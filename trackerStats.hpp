@@ -0,0 +1,199 @@
+#ifndef TRACKERSTATS_HPP
+#define TRACKERSTATS_HPP
+#include <atomic>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "carbonTracker.hpp"
+#include "logger.hpp"
+
+using namespace std;
+
+// Build with CT_ENABLE_STATS to count CarbonTracker activity from the CT_STAT calls on the hot paths. Without it
+// they compile to nothing. TrackerStats itself is always built, so it can be fed and read directly.
+#ifdef CT_ENABLE_STATS
+#define CT_STAT(call) TrackerStats::call
+#else
+#define CT_STAT(call) ((void)0)
+#endif
+
+  /**
+   * \brief TrackerStats Class: counters of CarbonTracker activity - how often each operation runs, how much
+   *        carbon moves between each pair of pools, how often fractions are renormalized, failed (unit) checks
+   *        and the largest fraction drift seen
+   *
+   * Each thread counts into its own cache line aligned slot, so counting takes no lock and threads never share
+   * a line. Only the owning thread writes a slot, so a count is a relaxed load and store of an atomic rather than
+   * a locked read-modify-write. When a thread exits its counts are folded into a retired total and its slot goes
+   * to the next thread that counts, so only as many slots are allocated as threads counted at the same time.
+   * collect adds the slots and the retired total up on demand, also while other threads are still counting -
+   * call it (or writeJson / log) during or at the end of a run to see which pools and fluxes dominate
+   */
+  class TrackerStats{
+   public:
+
+    // Counted operations
+    enum Op {
+      ADD, SUBTRACT, MULTIPLY, DIVIDE, FLUX, TRANSFER, N_OPS
+    };
+
+    // Sum of the counters over all threads - pool pairs are indexed [from][to], LAST if unknown
+    struct Counts {
+      uint64_t ops[N_OPS];
+      double moved[CarbonTracker::LAST + 1][CarbonTracker::LAST + 1];
+      uint64_t renormalizations;
+      uint64_t checkFailures;
+      uint64_t unitFailures;
+      double maxDrift;
+    };
+
+   private:
+
+    // Counters of one thread - same layout as Counts, read by collect while the thread may be counting
+    struct alignas(64) Slot {
+      atomic<uint64_t> ops[N_OPS];
+      atomic<double> moved[CarbonTracker::LAST + 1][CarbonTracker::LAST + 1];
+      atomic<uint64_t> renormalizations;
+      atomic<uint64_t> checkFailures;
+      atomic<uint64_t> unitFailures;
+      atomic<double> maxDrift;
+    };
+
+    // Every slot and what finished threads left - guarded by a lock in trackerStats.cpp
+    struct Registry {
+      vector<Slot*> slots;      // in registration order
+      vector<Slot*> free;       // cleared slots of finished threads
+      vector<char*> memory;     // allocations the slots were lined up in
+      Counts retired;           // counts of finished threads
+
+      Registry();
+      ~Registry();
+    };
+
+    // slot of the calling thread - null until it counts something
+    static thread_local Slot* current;
+
+    // folds the calling thread's slot into the retired total and frees it when the thread exits
+    struct Release {
+      ~Release();
+    };
+
+    static Registry& registry();
+
+    /**
+      * \brief gives the calling thread a finished thread's slot, or creates and registers a new one
+      */
+    static Slot* registerThread();
+
+    static Slot& slot(){
+        return current ? *current : *registerThread();
+    }
+
+    /**
+      * \brief zeroes a slot
+      */
+    static void clear(Slot& s);
+
+    /**
+      * \brief adds a slot's counts to a total
+      */
+    static void addTo(Counts& total, const Slot& s);
+
+    // only the owning thread writes its slot, so no read-modify-write is needed to keep counts exact
+    template<class T>
+    static void add(atomic<T>& counter, T amount){
+        counter.store(counter.load(memory_order_relaxed) + amount, memory_order_relaxed);
+    }
+
+   public:
+
+    /**
+      * \brief counts one operation
+      */
+    static void countOp(Op op){
+        add<uint64_t>(slot().ops[op], 1);
+    }
+
+    /**
+      * \brief adds carbon moved from one pool to another
+      * \param from pool the carbon left (LAST if unknown)
+      * \param to pool the carbon entered (LAST if unknown)
+      * \param amount carbon moved (pg C)
+      */
+    static void countMoved(CarbonTracker::Pool from, CarbonTracker::Pool to, double amount){
+        add(slot().moved[from][to], amount);
+    }
+
+    /**
+      * \brief counts one recomputation of a pool's origin fractions
+      */
+    static void countRenormalization(){
+        add<uint64_t>(slot().renormalizations, 1);
+    }
+
+    /**
+      * \brief counts one failed check (CT_VALID) - unit checks are also counted on their own
+      * \param f kind of check that failed
+      */
+    static void countCheckFailure(ValidationStatus::Flag f){
+        Slot& s = slot();
+        add<uint64_t>(s.checkFailures, 1);
+        if(f == ValidationStatus::WRONG_UNITS){
+            add<uint64_t>(s.unitFailures, 1);
+        }
+    }
+
+    /**
+      * \brief notes how far a pool's fractions sum from 1 - the largest is kept
+      * \param drift |sum of fractions - 1|
+      */
+    static void noteDrift(double drift){
+        Slot& s = slot();
+        if(drift > s.maxDrift.load(memory_order_relaxed)){
+            s.maxDrift.store(drift, memory_order_relaxed);
+        }
+    }
+
+    /**
+      * \brief adds up every thread's slot - safe while threads count, each counter is read whole but the totals
+      *        are not one snapshot across counters
+      * \return the totals - maxDrift is the largest over all threads
+      */
+    static Counts collect();
+
+    /**
+      * \brief zeroes every thread's slot and the retired total - no thread may be counting while this runs
+      */
+    static void reset();
+
+    /**
+      * \brief getter for the number of slots allocated
+      * \return most threads that have counted at the same time
+      */
+    static size_t slots();
+
+    /**
+      * \brief writes the totals as one JSON object
+      * \param out stream to write to
+      */
+    static void writeJson(ostream& out);
+
+    /**
+      * \brief writes the totals to a log as JSON - only compiled where it is used, so runs without a Logger
+      *        implementation can still use the rest of TrackerStats
+      * \param log Logger to write to
+      */
+    template<class LOG>
+    static void log(LOG& log){
+        H_LOG(log, LOG::NOTICE) << "CarbonTracker stats " << toJson() << std::endl;
+    }
+
+    /**
+      * \brief the totals as a JSON string
+      * \return JSON object
+      */
+    static string toJson();
+  };
+
+#endif
@@ -0,0 +1,105 @@
+#ifndef UNCERTAINTY_HPP
+#define UNCERTAINTY_HPP
+/*
+ *  uncertainty.hpp - carrying unitval::error() through CarbonTracker mixing
+ *
+ *  Two modes, both run through BasicCarbonTracker in a single pass:
+ *
+ *  Linearized:  each uncertain input becomes one derivative lane of a
+ *               dualUnitval scaled by its error, so lane i holds the first
+ *               order effect of input i. Correlations introduced by mixing
+ *               (the same total in numerator and denominator) are kept, and
+ *               the error of any result is the root sum of squares of its lanes.
+ *
+ *  Sampled:     each uncertain input becomes a batchUnitval of N normal
+ *               draws - a fixed size Monte Carlo sample carried in lanes
+ *               instead of N separate runs.
+ */
+
+#include <cmath>
+#include <random>
+
+#include "unitval.hpp"
+#include "dualUnitval.hpp"
+#include "batchUnitval.hpp"
+
+namespace Hector {
+
+//-----------------------------------------------------------------------
+/*! \brief Make an uncertain input for linearized propagation.
+ *
+ *  \param x value with its error set
+ *  \param lane derivative lane owned by this input - one per independent input
+ */
+template<int N>
+inline dualUnitval<N> linearizedInput( const unitval& x, int lane ) {
+    dual<N> v( x.value( x.units() ) );
+    v.d[lane] = x.error();
+    return dualUnitval<N>( v, x.units() );
+}
+
+//-----------------------------------------------------------------------
+/*! \brief One standard deviation of a linearized result.
+ */
+template<int N>
+inline double linearizedError( const dual<N>& x ) {
+    double sumSq = 0.0;
+    for( int i = 0; i < N; ++i ) sumSq += x.d[i] * x.d[i];
+    return std::sqrt( sumSq );
+}
+
+template<int N>
+inline double linearizedError( const dualUnitval<N>& x ) {
+    return linearizedError( x.lanes() );
+}
+
+//-----------------------------------------------------------------------
+/*! \brief Make an uncertain input for sampled propagation.
+ *
+ *  Draws N normal samples with mean value() and standard deviation error().
+ */
+template<int N, class RNG>
+inline batchUnitval<N> sampledInput( const unitval& x, RNG& rng ) {
+    std::normal_distribution<double> dist( x.value( x.units() ), x.error() );
+    batch<N> v;
+    for( int i = 0; i < N; ++i ) v.v[i] = dist( rng );
+    return batchUnitval<N>( v, x.units() );
+}
+
+//-----------------------------------------------------------------------
+/*! \brief Sample mean of a sampled result.
+ */
+template<int N>
+inline double sampleMean( const batch<N>& x ) {
+    double sum = 0.0;
+    for( int i = 0; i < N; ++i ) sum += x.v[i];
+    return sum / N;
+}
+
+//-----------------------------------------------------------------------
+/*! \brief Sample standard deviation of a sampled result.
+ */
+template<int N>
+inline double sampleError( const batch<N>& x ) {
+    const double mean = sampleMean( x );
+    double sumSq = 0.0;
+    for( int i = 0; i < N; ++i ) sumSq += ( x.v[i] - mean ) * ( x.v[i] - mean );
+    return std::sqrt( sumSq / ( N - 1 ) );
+}
+
+//-----------------------------------------------------------------------
+/*! \brief Reduce a result back to a unitval with its error set.
+ */
+template<int N>
+inline unitval toUnitval( const dualUnitval<N>& x ) {
+    return unitval( x.lanes().val, x.units(), linearizedError( x ) );
+}
+
+template<int N>
+inline unitval toUnitval( const batchUnitval<N>& x ) {
+    return unitval( sampleMean( x.lanes() ), x.units(), sampleError( x.lanes() ) );
+}
+
+}
+
+#endif
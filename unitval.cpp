@@ -24,100 +24,72 @@ namespace Hector {
 using namespace std;
 using namespace boost;
 
+//------------------------------------------------------------------------------
+/*! \brief Names of the units, indexed by unit_types - NULL for units without one.
+ */
+static const char* const UNITS_NAMES[U_UNDEFINED + 1] = {
+    "(unitless)",          // U_UNITLESS
+    "ppmv CO2",            // U_PPMV_CO2
+    "ppbv",                // U_PPBV
+    "pptv",                // U_PPTV
+    "ppbv CH4",            // U_PPBV_CH4
+    "pptv CH4",            // U_PPTV_CH4
+    "ppbv N2O",            // U_PPBV_N2O
+    "pptv N2O",            // U_PPTV_N2O
+    "mol/yr",              // U_MOL_YR
+    "Tg CO",               // U_TG_CO
+    "Tg CH4",              // U_TG_CH4
+    "Tg N",                // U_TG_N
+    "Tg NMVOC",            // U_TG_NMVOC
+    "DU O3",               // U_DU_O3
+    "Gg S",                // U_GG_S
+    "Tg/ppbv",             // U_TG_PPBV
+    "degC",                // U_DEGC
+    "K",                   // U_K
+    "1_K",                 // U_1_K
+    "cm2/s",               // U_CM2_S
+    "cm",                  // U_CM
+    "cm/yr",               // U_CM_YR
+    "g",                   // U_G
+    "Tg",                  // U_TG
+    "Gg",                  // U_GG
+    "mol",                 // U_MOL
+    "Gmol",                // U_GMOL
+    "GT(?)",               // U_GT
+    "Pg C",                // U_PGC
+    "Pg C/yr",             // U_PGC_YR
+    "W/m2",                // U_W_M2
+    "W/m2/pptv",           // U_W_M2_PPTV
+    "W/m2/K",              // U_W_M2_K
+    NULL,                  // U_M3_S - no name
+    "pH",                  // U_PH
+    "uatm",                // U_UATM
+    "umol/kg",             // U_UMOL_KG
+    "mol/kg",              // U_MOL_KG
+    "gC/m/month/atm",      // U_gC_m2_month_uatm
+    "mol/l/atm",           // U_MOL_L_ATM
+    "mol/kg/atm",          // U_MOL_KG_ATM
+    NULL,                  // U_J_KG_C - no name
+    "dobson",              // U_DOBSON
+    "Years",               // U_YRS
+    "(undefined)"          // U_UNDEFINED
+};
+
+//------------------------------------------------------------------------------
+/*! \brief Return name of given unit, without building a string.
+ */
+const char* unitval::unitsNameCStr( const unit_types u ) {
+    if( u < 0 || u > U_UNDEFINED || !UNITS_NAMES[u] ) {
+        H_THROW( "Unhandled unit!" );
+    }
+    return UNITS_NAMES[u];
+}
+
 //------------------------------------------------------------------------------
 /*! \brief Return name of given unit.
  */
 string unitval::unitsName( const unit_types u ) {
-    switch( u ) {
-    case U_UNDEFINED: return "(undefined)";
-        break;
-    case U_UNITLESS: return "(unitless)";
-        break;
-    case U_PPMV_CO2: return "ppmv CO2";
-        break;
-    case U_PPBV: return "ppbv";
-        break;
-    case U_PPBV_CH4: return "ppbv CH4";
-        break;
-    case U_PPTV_CH4: return "pptv CH4";
-        break;
-    case U_PPBV_N2O: return "ppbv N2O";
-        break;
-    case U_PPTV_N2O: return "pptv N2O";
-        break;
-    case U_DU_O3: return "DU O3";
-        break;
-    case U_TG_N: return "Tg N";
-        break;
-    case U_GG_S: return "Gg S";
-        break;
-    case U_TG_CO: return "Tg CO";
-        break;
-    case U_TG_CH4: return "Tg CH4";
-        break;
-    case U_TG_NMVOC: return "Tg NMVOC";
-        break;
-    case U_TG_PPBV: return "Tg/ppbv";
-        break;
-    case U_MOL_YR: return "mol/yr";
-        break;
-    case U_PPTV: return "pptv";
-        break;
-    case U_DEGC: return "degC";
-        break;
-    case U_K: return "K";
-        break;
-    case U_1_K: return "1_K";
-        break;
-    case U_CM: return "cm";
-        break;
-    case U_CM_YR: return "cm/yr";
-        break;
-    case U_CM2_S: return "cm2/s";
-        break;
-    case U_G: return "g";
-        break;
-    case U_GG: return "Gg";
-        break;
-    case U_TG: return "Tg";
-        break;
-    case U_MOL: return "mol";
-        break;
-    case U_GMOL: return "Gmol";
-        break;
-    case U_GT: return "GT(?)";
-        break;
-    case U_PGC: return "Pg C";
-        break;
-    case U_PGC_YR: return "Pg C/yr";
-        break;
-    case U_W_M2: return "W/m2";
-        break;
-    case U_W_M2_PPTV: return "W/m2/pptv";
-        break;
-    case U_W_M2_K: return "W/m2/K";
-        break;
-    case U_PH: return "pH";
-        break;
-    case U_UATM: return "uatm";
-        break;
-    case U_UMOL_KG: return "umol/kg";
-        break;
-    case U_MOL_KG: return "mol/kg";
-        break;
-    case U_gC_m2_month_uatm: return "gC/m/month/atm";
-        break;
-    case U_MOL_L_ATM: return "mol/l/atm";
-        break;
-    case U_MOL_KG_ATM: return "mol/kg/atm";
-        break;
-    case U_DOBSON: return "dobson";
-        break;
-    case U_YRS: return "Years";
-        break;
-
-    default: H_THROW( "Unhandled unit!" );
-    }
+    return unitsNameCStr( u );
 }
 
 //------------------------------------------------------------------------------
@@ -133,9 +105,8 @@ unit_types unitval::parseUnitsName( const string& unitsStr ) throw( h_exception
      * \warning All inits in unit_types must be defined before U_UNDEFINED.
      */
     for( int i = 0; i <= U_UNDEFINED; ++i ) {
-        const unit_types u = static_cast<unit_types>( i );
-        if( unitsStr == unitsName( u ) ) {
-            return u;
+        if( UNITS_NAMES[i] && unitsStr == UNITS_NAMES[i] ) {
+            return static_cast<unit_types>( i );
         }
     }
 
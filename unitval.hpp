@@ -32,6 +32,18 @@
 #define MISSING_FLOAT NAN
 #endif
 
+// Define UNITVAL_PROPAGATE_ERRORS to carry valErr through the arithmetic
+// operators (first order, operands assumed independent). Off by default so
+// the operators stay a single floating point operation. For correlated
+// errors, e.g. through CarbonTracker mixing, use the lane types in
+// uncertainty.hpp instead.
+#ifdef UNITVAL_PROPAGATE_ERRORS
+#include <cmath>
+#define UNITVAL_ERR(e) (e)
+#else
+#define UNITVAL_ERR(e) 0.0
+#endif
+
 namespace Hector {
 
 /*! \brief A simple value-and-units capability.
@@ -135,14 +147,17 @@ class unitval {
 
 public:
     static std::string unitsName( const unit_types );
+    static const char* unitsNameCStr( const unit_types );
     static unit_types parseUnitsName( const std::string& ) throw( h_exception );
 
     unitval();
     unitval( double, unit_types );
+    unitval( double, unit_types, double );
 
     void set( double, unit_types, double );
 
     double value( unit_types ) const throw( h_exception );
+    double error() const { return valErr; };
     unit_types units() const { return valUnits; };
     std::string unitsName() const { return unitsName( valUnits ); };
     void expecting_unit( const unit_types& ) throw( h_exception );
@@ -190,6 +205,19 @@ unitval::unitval() {
 inline
 unitval::unitval( double v, unit_types u ) {
     val = v;
+    valErr = 0.0;
+    valUnits = u;
+}
+
+//-----------------------------------------------------------------------
+/*! \brief Constructor for units data type.
+ *
+ *  Initializes internal variables and sets value, units and error.
+ */
+inline
+unitval::unitval( double v, unit_types u, double err ) {
+    val = v;
+    valErr = err;
     valUnits = u;
 }
 
@@ -233,24 +261,26 @@ double unitval::value( unit_types u ) const throw( h_exception ) {
 /*! \brief Operator overload: addition.
  *
  *  Add two unitvals. Must be of the same type.
- *  TODO: should we add the errors?
+ *  Errors add in quadrature when propagating errors.
  */
 inline
 unitval operator+ ( const unitval& lhs, const unitval& rhs ) {
 	H_ASSERT( lhs.valUnits==rhs.valUnits, "units mismatch" );
-    return unitval( lhs.val+rhs.val, lhs.valUnits );
+    return unitval( lhs.val+rhs.val, lhs.valUnits,
+                    UNITVAL_ERR( std::sqrt( lhs.valErr*lhs.valErr + rhs.valErr*rhs.valErr ) ) );
 }
 
 //-----------------------------------------------------------------------
 /*! \brief Operator overload: subtraction.
  *
  *  Subtract two unitvals. Must be of the same type.
- *  TODO: should we add the errors?
+ *  Errors add in quadrature when propagating errors.
  */
 inline
 unitval operator- ( const unitval& lhs, const unitval& rhs ) {
 	H_ASSERT( lhs.valUnits==rhs.valUnits, "units mismatch" );
-    return unitval( lhs.val-rhs.val, lhs.valUnits );
+    return unitval( lhs.val-rhs.val, lhs.valUnits,
+                    UNITVAL_ERR( std::sqrt( lhs.valErr*lhs.valErr + rhs.valErr*rhs.valErr ) ) );
 }
 
 //-----------------------------------------------------------------------
@@ -260,51 +290,52 @@ unitval operator- ( const unitval& lhs, const unitval& rhs ) {
  */
 inline
 unitval operator- ( const unitval& rhs ) {
-    return unitval( -rhs.val, rhs.valUnits );
+    return unitval( -rhs.val, rhs.valUnits, rhs.valErr );
 }
 
 //-----------------------------------------------------------------------
 /*! \brief Operator overload: constant multiplication.
  *
  *  Multiply a unitval by a double.
- *  TODO: should we multiply error as well?
+ *  The error scales with the value when propagating errors.
  */
 inline
 unitval operator* ( const unitval& lhs, const double rhs ) {
-    return unitval( lhs.val*rhs, lhs.valUnits );
+    return unitval( lhs.val*rhs, lhs.valUnits, UNITVAL_ERR( lhs.valErr*std::fabs( rhs ) ) );
 }
 
 //-----------------------------------------------------------------------
 /*! \brief Operator overload: constant multiplication.
  *
  *  Multiply a unitval by a double.
- *  TODO: should we multiply error as well?
+ *  The error scales with the value when propagating errors.
  */
 inline
 unitval operator* ( const double lhs, const unitval& rhs ) {
-    return unitval( lhs*rhs.val, rhs.valUnits );
+    return unitval( lhs*rhs.val, rhs.valUnits, UNITVAL_ERR( rhs.valErr*std::fabs( lhs ) ) );
 }
 
 //-----------------------------------------------------------------------
 /*! \brief Operator overload: constant division.
  *
  *  Divide a unitval by a double.
- *  TODO: should we divide error as well?
+ *  The error scales with the value when propagating errors.
  */
 inline
 unitval operator/ ( const unitval& lhs, const double rhs ) {
-    return unitval( lhs.val/rhs, lhs.valUnits );
+    return unitval( lhs.val/rhs, lhs.valUnits, UNITVAL_ERR( lhs.valErr/std::fabs( rhs ) ) );
 }
 
 //-----------------------------------------------------------------------
 /*! \brief Operator overload: constant division.
  *
- *  Divide a unitval by a double.
- *  TODO: should we divide error as well?
+ *  Divide a double by a unitval.
+ *  First order error d(a/x) = a/x^2 dx when propagating errors.
  */
 inline
 unitval operator/ ( const double lhs, const unitval& rhs ) {
-    return unitval( lhs/rhs.val, rhs.valUnits );
+    return unitval( lhs/rhs.val, rhs.valUnits,
+                    UNITVAL_ERR( std::fabs( lhs/( rhs.val*rhs.val ) )*rhs.valErr ) );
 }
 
 //-----------------------------------------------------------------------
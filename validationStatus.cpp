@@ -0,0 +1,62 @@
+#include <sstream>
+#include "validationStatus.hpp"
+#include "h_exception.hpp"
+
+using namespace std;
+
+const size_t ValidationStatus::RING_SIZE;
+
+ValidationStatus::ValidationStatus() : word(0), count(0){
+}
+
+bool ValidationStatus::flag(Flag f, const char* msg, const char* func, const char* file, int line) noexcept{
+    Diagnostic& d = ring[count % RING_SIZE];
+    d.msg = msg;
+    d.func = func;
+    d.file = file;
+    d.line = line;
+    d.flag = f;
+    word |= f;
+    ++count;
+    return false;
+}
+
+uint32_t ValidationStatus::status() const{
+    return word;
+}
+
+uint64_t ValidationStatus::violations() const{
+    return count;
+}
+
+const ValidationStatus::Diagnostic& ValidationStatus::diagnostic(size_t i) const{
+    H_ASSERT(i < diagnostics(), "No diagnostic at that index");
+    size_t oldest = count > RING_SIZE ? count % RING_SIZE : 0;
+    return ring[(oldest + i) % RING_SIZE];
+}
+
+size_t ValidationStatus::diagnostics() const{
+    return count < RING_SIZE ? count : RING_SIZE;
+}
+
+void ValidationStatus::check(){
+    if(word == 0){
+        return;
+    }
+    ostringstream msg;
+    msg << count << " deferred assertion(s) failed";
+    if(count > RING_SIZE){
+        msg << ", last " << RING_SIZE << " shown";
+    }
+    for(size_t i = 0; i < diagnostics(); ++i){
+        const Diagnostic& d = diagnostic(i);
+        msg << "\n  " << d.msg << " (" << d.func << ", " << d.file << ":" << d.line << ")";
+    }
+    clear();
+    H_THROW(msg.str());
+}
+
+void ValidationStatus::clear(){
+    word = 0;
+    count = 0;
+}
@@ -0,0 +1,100 @@
+#ifndef VALIDATIONSTATUS_HPP
+#define VALIDATIONSTATUS_HPP
+#include <cstddef>
+#include <stdint.h>
+
+using namespace std;
+
+  /**
+   * \brief ValidationStatus Class: violations collected by the carbon tracker hot paths when they are built with
+   *        CARBONTRACKER_DEFERRED_VALIDATION
+   *
+   * Instead of throwing, a failed check sets a bit in the status word and writes a diagnostic (no strings are
+   * copied - the message and location are pointers to literals) into a small ring that keeps the most recent ones.
+   * The step loop calls check once per timestep, which raises a single h_exception describing everything collected
+   */
+  class ValidationStatus{
+   public:
+
+    // Kind of violation - bits of the status word
+    enum Flag {
+      WRONG_UNITS = 1, NEGATIVE_CARBON = 2, FRACTION_DRIFT = 4, DIVIDE_BY_ZERO = 8, BAD_POOL = 16, NOT_CONVERGED = 32
+    };
+
+    // One violation
+    struct Diagnostic {
+      const char* msg;   // what was checked
+      const char* func;  // function the check is in
+      const char* file;
+      int line;
+      Flag flag;
+    };
+
+    // number of diagnostics kept - older ones are overwritten
+    static const size_t RING_SIZE = 16;
+
+   private:
+
+    // or of every Flag raised since the last check or clear
+    uint32_t word;
+
+    // violations since the last check or clear - may be more than the ring holds
+    uint64_t count;
+
+    // most recent diagnostics - entry count % RING_SIZE is written next
+    Diagnostic ring[RING_SIZE];
+
+   public:
+
+    /**
+      * \brief constructor - no violations
+      */
+    ValidationStatus();
+
+    /**
+      * \brief records a violation - never throws so the checks can sit in noexcept code
+      * \param f kind of violation
+      * \param msg what was checked (string literal)
+      * \param func, file, line where the check is (__func__, __FILE__, __LINE__)
+      * \return false, so it can stand in for the failed condition
+      */
+    bool flag(Flag f, const char* msg, const char* func, const char* file, int line) noexcept;
+
+    /**
+      * \brief getter for the status word
+      * \return or of every Flag raised since the last check or clear - 0 when everything passed
+      */
+    uint32_t status() const;
+
+    /**
+      * \brief getter for the number of violations since the last check or clear
+      * \return violation count
+      */
+    uint64_t violations() const;
+
+    /**
+      * \brief getter for a kept diagnostic
+      * \param i index - 0 is the oldest kept, at most RING_SIZE are kept
+      * \return the diagnostic
+      */
+    const Diagnostic& diagnostic(size_t i) const;
+
+    /**
+      * \brief getter for the number of diagnostics kept
+      * \return violations, capped at RING_SIZE
+      */
+    size_t diagnostics() const;
+
+    /**
+      * \brief throws one h_exception listing the kept diagnostics if anything was flagged, then clears - call once
+      *        per timestep
+      */
+    void check();
+
+    /**
+      * \brief forgets every violation
+      */
+    void clear();
+  };
+
+#endif